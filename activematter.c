@@ -0,0 +1,81 @@
+/* Library implementation of bird flocking simulation on the cell list kernel, see activematter.h */
+
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include "./activematter.h"
+#include "./params.h"
+#include "./cells_kernel.h"
+#include "./trajectory.h" // Provides the trajectory reader declared in activematter.h
+
+struct am_sim {
+  am_state_t state;    // Live view handed out by am_state
+  am_params params;    // Parameters the simulation was created with
+  double *mean_theta;  // Scratch array for the mean directions
+  double *gathered;    // Scratch space of the cell list kernel
+  cell_list cells;     // Neighbour index, kept up to date by every step
+};
+
+am_params am_default_params(void) {
+  am_params p = {V0_DEFAULT, ETA_DEFAULT, L_DEFAULT, R_DEFAULT, DT_DEFAULT};
+  return p;
+}
+
+am_sim *am_create(size_t n, unsigned int seed, const am_params *params) {
+  am_params p = params != NULL ? *params : am_default_params();
+  if (!(p.l > 0 && p.r >= 0 && p.dt > 0) || n > INT_MAX) return NULL;
+
+  am_sim *sim = calloc(1, sizeof(am_sim));
+  if (sim == NULL) return NULL;
+
+  // One block for all arrays keeps them adjacent and makes cleanup trivial
+  double *block = malloc(6 * (n > 0 ? n : 1) * sizeof(double));
+  if (block == NULL) {
+    free(sim);
+    return NULL;
+  }
+
+  sim->state.n = n;
+  sim->state.x = block;
+  sim->state.y = block + n;
+  sim->state.vx = block + 2 * n;
+  sim->state.vy = block + 3 * n;
+  sim->state.theta = block + 4 * n;
+  sim->mean_theta = block + 5 * n;
+  sim->params = p;
+
+  // Same stream and order of draws as the command line backends
+  am_state_t *s = &sim->state;
+  srand(seed);
+  initialize_velocities(s->vx, s->vy, s->theta, n, p.v0);
+  initialize_positions(s->x, s->y, n, p.l);
+
+  if (cell_list_init(&sim->cells, s->x, s->y, n, p.l, p.r) != 0 ||
+      (sim->gathered = malloc(4 * sim->cells.pool_cap * sizeof(double))) == NULL) {
+    am_destroy(sim);
+    return NULL;
+  }
+  return sim;
+}
+
+void am_step(am_sim *sim, int k) {
+  am_state_t *s = &sim->state;
+  const am_params *p = &sim->params;
+  for (int t = 0; t < k; t++) {
+    simulation_step(s->x, s->y, s->vx, s->vy, s->theta, sim->mean_theta, sim->gathered, s->n, &sim->cells,
+                    p->dt, p->eta, p->v0, p->r, p->l);
+    s->step++;
+  }
+}
+
+const am_state_t *am_state(am_sim *sim) {
+  return &sim->state;
+}
+
+void am_destroy(am_sim *sim) {
+  if (sim == NULL) return;
+  cell_list_free(&sim->cells);
+  free(sim->gathered);
+  free(sim->state.x);
+  free(sim);
+}
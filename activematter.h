@@ -0,0 +1,144 @@
+#ifndef ACTIVEMATTER_H
+#define ACTIVEMATTER_H
+
+/* Embedding API for the bird flocking simulation and its trajectory files (built as libactivematter.so) */
+
+#include <stddef.h>
+
+/**
+ * @brief Opaque handle to a running simulation.
+ */
+typedef struct am_sim am_sim;
+
+/**
+ * @brief View of the live simulation state.
+ *
+ * The arrays point straight into the simulation's own storage (one array per
+ * quantity, n elements each), so they reflect every later call to am_step.
+ * They stay valid until am_destroy is called on the owning simulation.
+ */
+typedef struct {
+  size_t n;      // Number of birds
+  long step;     // Number of time steps taken so far
+  double *x;     // x positions
+  double *y;     // y positions
+  double *vx;    // x components of velocity
+  double *vy;    // y components of velocity
+  double *theta; // Directions of velocity
+} am_state_t;
+
+/**
+ * @brief Physical parameters of a simulation.
+ */
+typedef struct {
+  double v0;  // Speed of each bird
+  double eta; // Noise parameter affecting the change in direction
+  double l;   // Size of the simulation area (must be positive)
+  double r;   // Radius within which birds consider their neighbors (must not be negative)
+  double dt;  // Time step for each update (must be positive)
+} am_params;
+
+/**
+ * @brief Returns the default parameters from params.h.
+ *
+ * @return The default parameters.
+ */
+am_params am_default_params(void);
+
+/**
+ * @brief Creates a simulation with randomly initialized birds.
+ *
+ * Steps run the cell list kernel of c_cells. Like the command line backends,
+ * the simulation draws from the process-wide rand() stream, which this call
+ * seeds; a simulation created with seed 1 therefore follows the same run as
+ * the backends with the same parameters, as long as nothing else draws from
+ * rand() in between (including another simulation being stepped).
+ *
+ * @param n Number of birds (at most INT_MAX).
+ * @param seed Seed passed to srand().
+ * @param params Parameters of the simulation (copied), or NULL for am_default_params().
+ * @return The new simulation, or NULL if the parameters are invalid or allocation failed.
+ */
+am_sim *am_create(size_t n, unsigned int seed, const am_params *params);
+
+/**
+ * @brief Advances the simulation by k time steps.
+ *
+ * @param sim The simulation.
+ * @param k Number of time steps to take.
+ */
+void am_step(am_sim *sim, int k);
+
+/**
+ * @brief Returns the live state of the simulation.
+ *
+ * @param sim The simulation.
+ * @return Pointer to a view owned by the simulation; see am_state_t.
+ */
+const am_state_t *am_state(am_sim *sim);
+
+/**
+ * @brief Frees a simulation and all of its arrays.
+ *
+ * @param sim The simulation (may be NULL).
+ */
+void am_destroy(am_sim *sim);
+
+/**
+ * @brief Opaque handle to a trajectory file written with --output (see trajectory.h).
+ */
+typedef struct traj_reader traj_reader;
+
+/**
+ * @brief Opens a trajectory file and indexes its blocks.
+ *
+ * @param path The path of the file.
+ * @return The reader, or NULL on error.
+ */
+traj_reader *traj_open_reader(const char *path);
+
+/**
+ * @brief Returns the number of birds in a trajectory.
+ *
+ * @param r The reader.
+ * @return The number of birds.
+ */
+size_t traj_n(const traj_reader *r);
+
+/**
+ * @brief Returns the side length of the square of a trajectory.
+ *
+ * @param r The reader.
+ * @return The side length.
+ */
+double traj_l(const traj_reader *r);
+
+/**
+ * @brief Returns the number of complete frames in a trajectory.
+ *
+ * @param r The reader.
+ * @return The number of frames.
+ */
+size_t traj_n_frames(const traj_reader *r);
+
+/**
+ * @brief Reads one frame of a trajectory.
+ *
+ * @param r The reader.
+ * @param frame Index of the frame, in [0, traj_n_frames(r)).
+ * @param step Receives the time step of the frame (may be NULL).
+ * @param x Receives the traj_n(r) x positions.
+ * @param y Receives the traj_n(r) y positions.
+ * @param theta Receives the traj_n(r) directions.
+ * @return 0 on success, -1 on error.
+ */
+int traj_read_frame(traj_reader *r, size_t frame, long *step, double *x, double *y, double *theta);
+
+/**
+ * @brief Closes a trajectory and frees the reader.
+ *
+ * @param r The reader (may be NULL).
+ */
+void traj_close_reader(traj_reader *r);
+
+#endif
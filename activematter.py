@@ -0,0 +1,191 @@
+"""Thin Python binding for libactivematter.so (see activematter.h).
+
+The arrays exposed by `Simulation` are NumPy views onto the C arrays, so they
+are never copied and always show the state after the latest `step` call:
+
+    sim = Simulation(5000)
+    x, y = sim.x, sim.y
+    sim.step(10)  # x and y now hold the positions after 10 steps
+"""
+
+import ctypes
+import os
+
+import numpy as np
+
+
+class _State(ctypes.Structure):
+    _fields_ = [
+        ("n", ctypes.c_size_t),
+        ("step", ctypes.c_long),
+        ("x", ctypes.POINTER(ctypes.c_double)),
+        ("y", ctypes.POINTER(ctypes.c_double)),
+        ("vx", ctypes.POINTER(ctypes.c_double)),
+        ("vy", ctypes.POINTER(ctypes.c_double)),
+        ("theta", ctypes.POINTER(ctypes.c_double)),
+    ]
+
+
+class Params(ctypes.Structure):
+    """Physical parameters of a simulation (am_params in activematter.h)."""
+
+    _fields_ = [
+        ("v0", ctypes.c_double),
+        ("eta", ctypes.c_double),
+        ("l", ctypes.c_double),
+        ("r", ctypes.c_double),
+        ("dt", ctypes.c_double),
+    ]
+
+
+_double_array = np.ctypeslib.ndpointer(dtype=np.float64, flags="C_CONTIGUOUS")
+
+
+def load_library(path=None):
+    if path is None:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "build", "libactivematter.so")
+    lib = ctypes.CDLL(path)
+    lib.am_default_params.argtypes = []
+    lib.am_default_params.restype = Params
+    lib.am_create.argtypes = [ctypes.c_size_t, ctypes.c_uint, ctypes.POINTER(Params)]
+    lib.am_create.restype = ctypes.c_void_p
+    lib.am_step.argtypes = [ctypes.c_void_p, ctypes.c_int]
+    lib.am_step.restype = None
+    lib.am_state.argtypes = [ctypes.c_void_p]
+    lib.am_state.restype = ctypes.POINTER(_State)
+    lib.am_destroy.argtypes = [ctypes.c_void_p]
+    lib.am_destroy.restype = None
+    lib.traj_open_reader.argtypes = [ctypes.c_char_p]
+    lib.traj_open_reader.restype = ctypes.c_void_p
+    lib.traj_n.argtypes = [ctypes.c_void_p]
+    lib.traj_n.restype = ctypes.c_size_t
+    lib.traj_l.argtypes = [ctypes.c_void_p]
+    lib.traj_l.restype = ctypes.c_double
+    lib.traj_n_frames.argtypes = [ctypes.c_void_p]
+    lib.traj_n_frames.restype = ctypes.c_size_t
+    lib.traj_read_frame.argtypes = [
+        ctypes.c_void_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_long),
+        _double_array, _double_array, _double_array,
+    ]
+    lib.traj_read_frame.restype = ctypes.c_int
+    lib.traj_close_reader.argtypes = [ctypes.c_void_p]
+    lib.traj_close_reader.restype = None
+    return lib
+
+
+class Simulation:
+    """A simulation living in C memory.
+
+    `x`, `y`, `vx`, `vy` and `theta` share memory with the simulation; each
+    view keeps the simulation alive, so the C arrays are freed only once the
+    simulation and every view taken from it are gone.
+
+    Keyword arguments override fields of the default `Params`:
+
+        sim = Simulation(5000, l=50.0, eta=0.3)
+    """
+
+    def __init__(self, n: int = 5000, seed: int = 1, lib=None, **params):
+        self._lib = lib if lib is not None else load_library()
+        self.params = self._lib.am_default_params()
+        for name, value in params.items():
+            if name not in dict(Params._fields_):
+                raise TypeError(f"unknown simulation parameter {name!r}")
+            setattr(self.params, name, value)
+        self._sim = self._lib.am_create(n, seed, ctypes.byref(self.params))
+        if not self._sim:
+            raise ValueError(f"am_create failed for n={n} with "
+                             + ", ".join(f"{name}={getattr(self.params, name)}" for name, _ in Params._fields_))
+        self._state = self._lib.am_state(self._sim).contents
+
+    def _view(self, pointer):
+        # The view's base is the ctypes buffer, which holds on to the simulation
+        buffer = (ctypes.c_double * self._state.n).from_address(ctypes.addressof(pointer.contents))
+        buffer._owner = self
+        return np.ctypeslib.as_array(buffer)
+
+    @property
+    def x(self) -> np.ndarray:
+        return self._view(self._state.x)
+
+    @property
+    def y(self) -> np.ndarray:
+        return self._view(self._state.y)
+
+    @property
+    def vx(self) -> np.ndarray:
+        return self._view(self._state.vx)
+
+    @property
+    def vy(self) -> np.ndarray:
+        return self._view(self._state.vy)
+
+    @property
+    def theta(self) -> np.ndarray:
+        return self._view(self._state.theta)
+
+    @property
+    def n(self) -> int:
+        return self._state.n
+
+    @property
+    def steps(self) -> int:
+        return self._state.step
+
+    def step(self, k: int = 1) -> None:
+        self._lib.am_step(self._sim, k)
+
+    def __del__(self):
+        if getattr(self, "_sim", None):
+            self._lib.am_destroy(self._sim)
+            self._sim = None
+
+
+class Trajectory:
+    """A trajectory file written with --output (see trajectory.h).
+
+    Frames can be read in any order; `read` returns new arrays unless
+    `out` is given as an (x, y, theta) tuple of float64 arrays of shape (n,)
+    to fill.
+    """
+
+    def __init__(self, path: str, lib=None):
+        self._lib = lib if lib is not None else load_library()
+        self._reader = self._lib.traj_open_reader(os.fsencode(path))
+        if not self._reader:
+            raise OSError(f"cannot read trajectory {path}")
+        self.n = self._lib.traj_n(self._reader)
+        self.l = self._lib.traj_l(self._reader)
+        self.frames = self._lib.traj_n_frames(self._reader)
+
+    def __len__(self) -> int:
+        return self.frames
+
+    def read(self, frame: int, out=None):
+        """Return (step, x, y, theta) of one frame."""
+        if not 0 <= frame < self.frames:
+            raise IndexError(frame)
+        if out is None:
+            out = tuple(np.empty(self.n) for _ in range(3))
+        elif len(out) != 3 or any(a.shape != (self.n,) or a.dtype != np.float64 or not a.flags.c_contiguous
+                                  for a in out):
+            raise ValueError(f"out must be three contiguous float64 arrays of shape ({self.n},)")
+        x, y, theta = out
+        step = ctypes.c_long()
+        if self._lib.traj_read_frame(self._reader, frame, ctypes.byref(step), x, y, theta) != 0:
+            raise OSError(f"failed to decode frame {frame}")
+        return step.value, x, y, theta
+
+    def close(self) -> None:
+        if getattr(self, "_reader", None):
+            self._lib.traj_close_reader(self._reader)
+            self._reader = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
@@ -17,6 +17,7 @@ for birds in 128 256 512 1024 2048 4096; do
   touch c_blas-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
   touch c_mpi-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
   touch c_omp-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
+  touch c_cells-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
 
   for i in 1 2 3 4 5; do 
     echo "Running $i c_dumb $birds" >> c_dumb-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
@@ -27,6 +28,8 @@ for birds in 128 256 512 1024 2048 4096; do
     srun ./c_mpi $birds  >> c_mpi-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
     echo "Running $i c_omp $birds" >> c_omp-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
     srun ./c_omp $birds  >> c_omp-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
+    echo "Running $i c_cells $birds" >> c_cells-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
+    srun ./c_cells $birds  >> c_cells-${SLURM_JOB_NUM_NODES}-${SLURM_NTASKS}-${birds}.txt
   done
 done
 
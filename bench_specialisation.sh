@@ -0,0 +1,56 @@
+#!/bin/bash
+# Compares the kernels specialised for (R, L) against the generic fallback.
+# The perturbed values are far too small to change the physics, but miss
+# the constants in SPECIALISED_RL and so select the other code paths.
+#
+# The "macros" column is the baseline: the same backend built from the tree
+# before parameters became configurable (BASELINE_REF, by default the parent
+# of the commit that added this script), where R, L and NT were compile-time
+# macros. It can only run R = 1, L = 100.
+#
+# Usage: ./bench_specialisation.sh [n_birds...]   (run `make` first)
+
+birds=("$@")
+if [ ${#birds[@]} -eq 0 ]; then
+  birds=(1000 2000 4000)
+fi
+nt=100
+repeats=3
+
+# Build the baseline with the compiler flags of the current Makefile
+baseline_ref=${BASELINE_REF:-$(git log --diff-filter=A --format=%H -- bench_specialisation.sh | tail -1)^}
+cflags=$(sed -n 's/^CFLAGS = $(PROFILE_CFLAGS)//p' Makefile | sed 's/#.*//')
+baseline_dir=$(mktemp -d)
+trap 'rm -rf "$baseline_dir"' EXIT
+for f in params.h utils.h main_dumb.c main_omp.c; do
+  git show "$baseline_ref:$f" > "$baseline_dir/$f" || exit 1
+done
+sed -i "s/^#define NT .*/#define NT $nt/" "$baseline_dir/params.h"
+for exe in c_dumb c_omp; do
+  gcc $cflags -o "$baseline_dir/$exe" "$baseline_dir/main_${exe#c_}.c" -lm -fopenmp || exit 1
+done
+
+best_of() {
+  local best=""
+  for i in $(seq $repeats); do
+    t=$("$@" | awk '/^Time:/ {print $2}')
+    if [ -z "$best" ] || awk "BEGIN {exit !($t < $best)}"; then best=$t; fi
+  done
+  echo "$best"
+}
+
+run() {
+  local exe=$1 n=$2 r=$3 l=$4
+  best_of ./build/$exe $n --nt $nt --r $r --l $l
+}
+
+printf "%-8s %8s %14s %14s %14s %14s\n" "backend" "birds" "macros" "R,L fixed" "R fixed" "generic"
+for exe in c_dumb c_omp; do
+  for n in "${birds[@]}"; do
+    printf "%-8s %8d %14s %14s %14s %14s\n" "$exe" "$n" \
+      "$(best_of "$baseline_dir/$exe" $n)" \
+      "$(run $exe $n 1.0 100.0)" \
+      "$(run $exe $n 1.0 100.000000001)" \
+      "$(run $exe $n 1.000000001 100.000000001)"
+  done
+done
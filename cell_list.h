@@ -0,0 +1,223 @@
+#ifndef CELL_LIST_H
+#define CELL_LIST_H
+
+/*
+ * Incrementally maintained cell list.
+ *
+ * The square is split into m x m cells at least r wide, so all neighbours of a
+ * bird lie in its own cell or the 8 around it. Each cell owns a segment of a
+ * shared pool of bird ids with some spare room. A bird that changes cell is
+ * swapped out of its old segment and appended to the new one in O(1); a full
+ * segment is moved to the end of the pool with twice the room, and once the
+ * pool runs out, all segments are packed again (defragmented). Keeping the
+ * index current therefore costs work only for birds that cross a cell border.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define CELL_LIST_SLACK 4 // Spare slots given to every cell when laid out
+
+/**
+ * @brief Cell list over the birds of a simulation.
+ */
+typedef struct {
+    int m;                 // Cells per side
+    double inv_cell_size;  // Inverse of the side length of one cell
+    int n;                 // Number of birds
+    int *cell_of;          // Cell of each bird
+    int *slot_of;          // Position of each bird in the pool
+    int *start;            // Start of each cell's segment in the pool
+    int *count;            // Birds in each cell
+    int *capacity;         // Length of each cell's segment
+    int *pool;             // Bird ids, one segment per cell
+    int *spare;            // Second pool used while defragmenting
+    size_t pool_len;       // End of the last segment
+    size_t pool_cap;       // Size of pool and spare
+    long n_moves;          // Birds moved between cells so far
+    long n_defrags;        // Defragmentations so far
+} cell_list;
+
+/**
+ * @brief Get the cell containing a point.
+ *
+ * @param cl The cell list.
+ * @param x The x coordinate, in [0, l).
+ * @param y The y coordinate, in [0, l).
+ * @return The cell index.
+ */
+static inline int cell_list_cell(const cell_list *cl, double x, double y) {
+    int cx = (int) (x * cl->inv_cell_size);
+    int cy = (int) (y * cl->inv_cell_size);
+    if (cx >= cl->m) cx = cl->m - 1;
+    if (cy >= cl->m) cy = cl->m - 1;
+    if (cx < 0) cx = 0;
+    if (cy < 0) cy = 0;
+    return cy * cl->m + cx;
+}
+
+/**
+ * @brief Pack all segments at the front of the pool, each with fresh spare room.
+ *
+ * @param cl The cell list.
+ */
+void cell_list_defragment(cell_list *cl) {
+    size_t offset = 0;
+    for (int c = 0; c < cl->m * cl->m; c++) {
+        int *src = cl->pool + cl->start[c];
+        for (int k = 0; k < cl->count[c]; k++) {
+            cl->spare[offset + k] = src[k];
+            cl->slot_of[src[k]] = offset + k;
+        }
+        cl->start[c] = offset;
+        cl->capacity[c] = cl->count[c] + cl->count[c] / 4 + CELL_LIST_SLACK;
+        offset += cl->capacity[c];
+    }
+
+    int *old = cl->pool;
+    cl->pool = cl->spare;
+    cl->spare = old;
+    cl->pool_len = offset;
+    cl->n_defrags++;
+}
+
+/**
+ * @brief Build the cell list for the given positions.
+ *
+ * @param cl The cell list to initialize.
+ * @param x Pointer to the array of x coordinates.
+ * @param y Pointer to the array of y coordinates.
+ * @param n Number of birds.
+ * @param l Side length of the square.
+ * @param r Radius within which birds consider their neighbors.
+ * @return 0 on success, -1 if allocation failed (call cell_list_free either way).
+ */
+int cell_list_init(cell_list *cl, const double *x, const double *y, int n, double l, double r) {
+    memset(cl, 0, sizeof(cell_list));
+    // Cells must be at least r wide; beyond a few per bird they only cost memory.
+    // The cap is applied before converting, as l / r may not fit in an int.
+    double m = r > 0 ? l / r : 1;
+    int max_m = (int) sqrt(4.0 * n) + 1;
+    cl->m = m < 1 ? 1 : m > max_m ? max_m : (int) m;
+    cl->inv_cell_size = cl->m / l;
+    cl->n = n;
+
+    // A packed layout never exceeds n * 5/4 + slack per cell; the rest is room for moved segments
+    int cells = cl->m * cl->m;
+    cl->pool_cap = 2 * ((size_t) n + n / 4 + (size_t) CELL_LIST_SLACK * cells);
+    cl->cell_of = malloc((n > 0 ? n : 1) * sizeof(int));
+    cl->slot_of = malloc((n > 0 ? n : 1) * sizeof(int));
+    cl->start = calloc(cells, sizeof(int));
+    cl->count = calloc(cells, sizeof(int));
+    cl->capacity = calloc(cells, sizeof(int));
+    cl->pool = malloc(cl->pool_cap * sizeof(int));
+    cl->spare = malloc(cl->pool_cap * sizeof(int));
+    if (cl->cell_of == NULL || cl->slot_of == NULL || cl->start == NULL || cl->count == NULL ||
+        cl->capacity == NULL || cl->pool == NULL || cl->spare == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        cl->cell_of[i] = cell_list_cell(cl, x[i], y[i]);
+        cl->count[cl->cell_of[i]]++;
+    }
+
+    // Lay out the segments, then fill them in bird order
+    size_t offset = 0;
+    for (int c = 0; c < cells; c++) {
+        cl->start[c] = offset;
+        cl->capacity[c] = cl->count[c] + cl->count[c] / 4 + CELL_LIST_SLACK;
+        offset += cl->capacity[c];
+        cl->count[c] = 0;
+    }
+    cl->pool_len = offset;
+    for (int i = 0; i < n; i++) {
+        int c = cl->cell_of[i];
+        int slot = cl->start[c] + cl->count[c]++;
+        cl->pool[slot] = i;
+        cl->slot_of[i] = slot;
+    }
+    return 0;
+}
+
+/**
+ * @brief Free the arrays of a cell list.
+ *
+ * @param cl The cell list.
+ */
+void cell_list_free(cell_list *cl) {
+    free(cl->cell_of);
+    free(cl->slot_of);
+    free(cl->start);
+    free(cl->count);
+    free(cl->capacity);
+    free(cl->pool);
+    free(cl->spare);
+}
+
+/**
+ * @brief Make room for at least one more bird in a full cell.
+ *
+ * @param cl The cell list.
+ * @param c The full cell.
+ */
+void cell_list_grow(cell_list *cl, int c) {
+    size_t capacity = 2 * (size_t) cl->capacity[c] + CELL_LIST_SLACK;
+    if (cl->pool_len + capacity > cl->pool_cap) {
+        // Packing gives every cell spare room again
+        cell_list_defragment(cl);
+        return;
+    }
+
+    int *src = cl->pool + cl->start[c];
+    for (int k = 0; k < cl->count[c]; k++) {
+        cl->pool[cl->pool_len + k] = src[k];
+        cl->slot_of[src[k]] = cl->pool_len + k;
+    }
+    cl->start[c] = cl->pool_len;
+    cl->capacity[c] = capacity;
+    cl->pool_len += capacity;
+}
+
+/**
+ * @brief Move a bird to another cell.
+ *
+ * @param cl The cell list.
+ * @param bird The bird.
+ * @param to The new cell of the bird.
+ */
+void cell_list_move(cell_list *cl, int bird, int to) {
+    // Fill the hole with the last bird of the old cell
+    int from = cl->cell_of[bird];
+    int slot = cl->slot_of[bird];
+    int last = cl->start[from] + --cl->count[from];
+    cl->pool[slot] = cl->pool[last];
+    cl->slot_of[cl->pool[slot]] = slot;
+
+    if (cl->count[to] == cl->capacity[to]) {
+        cell_list_grow(cl, to);
+    }
+    slot = cl->start[to] + cl->count[to]++;
+    cl->pool[slot] = bird;
+    cl->slot_of[bird] = slot;
+    cl->cell_of[bird] = to;
+    cl->n_moves++;
+}
+
+/**
+ * @brief Update the cell of a bird after it moved.
+ *
+ * @param cl The cell list.
+ * @param bird The bird.
+ * @param x The new x coordinate, in [0, l).
+ * @param y The new y coordinate, in [0, l).
+ */
+static inline void cell_list_update(cell_list *cl, int bird, double x, double y) {
+    int c = cell_list_cell(cl, x, y);
+    if (c != cl->cell_of[bird]) {
+        cell_list_move(cl, bird, c);
+    }
+}
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef CELLS_KERNEL_H
+#define CELLS_KERNEL_H
+
+/*
+ * Cell list step of the bird flocking simulation, shared by c_cells and the
+ * embedding library. Noise is drawn from rand(), in the same order as the
+ * other backends, so runs seeded alike can be compared.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "kernel.h"
+#include "cell_list.h"
+
+/**
+ * @brief Initializes the positions of birds randomly within a square of side length l.
+ *
+ * @param x Pointer to the array of x coordinates.
+ * @param y Pointer to the array of y coordinates.
+ * @param n Number of birds.
+ * @param l Side length of the square.
+ */
+void initialize_positions(double *x, double *y, int n, double l) {
+  for (int i = 0; i < n; i++) {
+    x[i] = ((double) rand() / RAND_MAX) * l;
+    y[i] = ((double) rand() / RAND_MAX) * l;
+  }
+}
+
+/**
+ * @brief Initializes the velocities of birds with random directions and a fixed speed.
+ *
+ * @param vx Pointer to the array of x components of velocity.
+ * @param vy Pointer to the array of y components of velocity.
+ * @param theta Pointer to the array of angles representing the direction of velocity.
+ * @param n Number of birds.
+ * @param v0 Speed of each bird.
+ */
+void initialize_velocities(double *vx, double *vy, double *theta, int n, double v0) {
+  for (int i = 0; i < n; i++) {
+    theta[i] = 2 * M_PI * ((double) rand() / RAND_MAX);
+    vx[i] = v0 * cos(theta[i]);
+    vy[i] = v0 * sin(theta[i]);
+  }
+}
+
+/**
+ * @brief Applies periodic boundary conditions and moves birds that left their cell.
+ *
+ * @param x Pointer to the array of x coordinates.
+ * @param y Pointer to the array of y coordinates.
+ * @param n Number of birds.
+ * @param l Side length of the square.
+ * @param cells The cell list, updated for birds that crossed a cell border (including wrap-arounds).
+ */
+KERNEL_INLINE void apply_periodic_boundary_conditions(double *x, double *y, int n, double l, cell_list *cells) {
+  for (int i = 0; i < n; i++) {
+    x[i] = fmod(x[i], l);
+    y[i] = fmod(y[i], l);
+    if (x[i] < 0) x[i] += l;
+    if (y[i] < 0) y[i] += l;
+    cell_list_update(cells, i, x[i], y[i]);
+  }
+}
+
+/**
+ * @brief Updates the positions of birds based on their velocities and a time step.
+ *
+ * @param x Pointer to the array of x coordinates.
+ * @param y Pointer to the array of y coordinates.
+ * @param vx Pointer to the array of x components of velocity.
+ * @param vy Pointer to the array of y components of velocity.
+ * @param n Number of birds.
+ * @param dt Time step for the update.
+ */
+void update_positions(double *x, double *y, double *vx, double *vy, int n, double dt) {
+  for (int i = 0; i < n; i++) {
+    x[i] += vx[i] * dt;
+    y[i] += vy[i] * dt;
+  }
+}
+
+/**
+ * @brief Calculates the mean direction (theta) of nearby birds for each bird.
+ *
+ * Positions and directions are first gathered into the order of the cell list
+ * pool, so that the 3 x 3 cells searched around each bird are read
+ * contiguously. Like the reference implementation, distances are not wrapped
+ * around the periodic boundary.
+ *
+ * @param mean_theta Pointer to the array of mean directions.
+ * @param gathered Pointer to scratch space for 4 * cells->pool_cap values.
+ * @param theta Pointer to the array of current directions.
+ * @param x Pointer to the array of x coordinates.
+ * @param y Pointer to the array of y coordinates.
+ * @param r Radius within which to consider neighboring birds.
+ * @param cells The cell list.
+ */
+KERNEL_INLINE void calculate_mean_theta(double *mean_theta, double *gathered, double *theta, double *x, double *y, double r, const cell_list *cells) {
+  double *gx = gathered, *gy = gathered + cells->pool_cap;
+  double *gcos = gathered + 2 * cells->pool_cap, *gsin = gathered + 3 * cells->pool_cap;
+  int m = cells->m;
+  for (int c = 0; c < m * m; c++) {
+    for (int s = cells->start[c]; s < cells->start[c] + cells->count[c]; s++) {
+      int i = cells->pool[s];
+      gx[s] = x[i];
+      gy[s] = y[i];
+      gcos[s] = cos(theta[i]);
+      gsin[s] = sin(theta[i]);
+    }
+  }
+
+  for (int cy = 0; cy < m; cy++) {
+    for (int cx = 0; cx < m; cx++) {
+      int c = cy * m + cx;
+      for (int b = cells->start[c]; b < cells->start[c] + cells->count[c]; b++) {
+        double sx = 0.0, sy = 0.0;
+        for (int ny = (cy > 0 ? cy - 1 : 0); ny <= (cy < m - 1 ? cy + 1 : m - 1); ny++) {
+          for (int nx = (cx > 0 ? cx - 1 : 0); nx <= (cx < m - 1 ? cx + 1 : m - 1); nx++) {
+            int nc = ny * m + nx;
+            for (int i = cells->start[nc]; i < cells->start[nc] + cells->count[nc]; i++) {
+              double dx = gx[i] - gx[b];
+              double dy = gy[i] - gy[b];
+              if (dx * dx + dy * dy < r * r) {
+                sx += gcos[i];
+                sy += gsin[i];
+              }
+            }
+          }
+        }
+        mean_theta[cells->pool[b]] = atan2(sy, sx);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Updates the directions (theta) of birds based on the mean directions and some noise.
+ *
+ * @param theta Pointer to the array of current directions.
+ * @param mean_theta Pointer to the array of mean directions.
+ * @param n Number of birds.
+ * @param eta Noise parameter affecting the change in direction.
+ */
+void update_theta(double *theta, double *mean_theta, int n, double eta) {
+  for (int b = 0; b < n; b++) {
+    theta[b] = mean_theta[b] + eta * (((double) rand() / RAND_MAX) - 0.5);
+  }
+}
+
+/**
+ * @brief Updates the velocities of birds based on their updated directions (theta).
+ *
+ * @param vx Pointer to the array of x components of velocity.
+ * @param vy Pointer to the array of y components of velocity.
+ * @param theta Pointer to the array of current directions.
+ * @param n Number of birds.
+ * @param v0 Speed of each bird.
+ */
+void update_velocities(double *vx, double *vy, double *theta, int n, double v0) {
+  for (int b = 0; b < n; b++) {
+    vx[b] = v0 * cos(theta[b]);
+    vy[b] = v0 * sin(theta[b]);
+  }
+}
+
+/**
+ * @brief Advances the simulation by one time step.
+ *
+ * @param x Pointer to the array of x coordinates.
+ * @param y Pointer to the array of y coordinates.
+ * @param vx Pointer to the array of x components of velocity.
+ * @param vy Pointer to the array of y components of velocity.
+ * @param theta Pointer to the array of current directions.
+ * @param mean_theta Pointer to the array of mean directions.
+ * @param gathered Pointer to scratch space for 4 * cells->pool_cap values.
+ * @param n Number of birds.
+ * @param cells The cell list.
+ * @param dt Time step for the update.
+ * @param eta Noise parameter affecting the change in direction.
+ * @param v0 Speed of each bird.
+ * @param r Radius within which to consider neighboring birds (a constant in specialised copies).
+ * @param l Side length of the square (a constant in specialised copies).
+ */
+KERNEL_INLINE void simulation_step_impl(double *x, double *y, double *vx, double *vy, double *theta, double *mean_theta, double *gathered, int n, cell_list *cells, double dt, double eta, double v0, double r, double l) {
+  update_positions(x, y, vx, vy, n, dt);
+  apply_periodic_boundary_conditions(x, y, n, l, cells);
+  calculate_mean_theta(mean_theta, gathered, theta, x, y, r, cells);
+  update_theta(theta, mean_theta, n, eta);
+  update_velocities(vx, vy, theta, n, v0);
+}
+
+DEFINE_SPECIALISED_KERNEL(simulation_step, simulation_step_impl,
+  (double *x, double *y, double *vx, double *vy, double *theta, double *mean_theta, double *gathered, int n, cell_list *cells, double dt, double eta, double v0),
+  (x, y, vx, vy, theta, mean_theta, gathered, n, cells, dt, eta, v0))
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+/*
+ * Helpers for compiling simulation kernels with constant (R, L), shared by the
+ * backends and the embedding library.
+ */
+
+#include "params.h"
+
+/**
+ * @brief Marks a kernel that must be inlined, so that constant arguments fold into its body.
+ */
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+#define SPECIALISE_UNPACK(...) __VA_ARGS__
+#define SPECIALISE_CASE(impl, args, r_, l_) \
+    if (r == (r_) && l == (l_)) { impl(SPECIALISE_UNPACK args, (r_), (l_)); return; }
+
+/**
+ * @brief Define a kernel that dispatches at runtime to copies of impl compiled for fixed r and l.
+ * 
+ * impl must be a KERNEL_INLINE function taking the arguments in params followed by
+ * double r and double l. The generated function name takes the same arguments and
+ * calls a copy of impl with the constants from SPECIALISED_RL when (r, l) matches
+ * one of them, one with only r fixed when r is 1, and the generic impl otherwise.
+ * 
+ * @param name Name of the generated kernel.
+ * @param impl The kernel implementation.
+ * @param params Parenthesised parameter declarations of impl, without r and l.
+ * @param args Parenthesised argument names matching params.
+ */
+#define DEFINE_SPECIALISED_KERNEL(name, impl, params, args) \
+    void name(SPECIALISE_UNPACK params, double r, double l) { \
+        SPECIALISED_RL(SPECIALISE_CASE, impl, args) \
+        if (r == 1.0) { impl(SPECIALISE_UNPACK args, 1.0, l); return; } \
+        impl(SPECIALISE_UNPACK args, r, l); \
+    }
+
+#endif
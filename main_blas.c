@@ -16,11 +16,11 @@ void initialize_positions(double *x, double *y, int n, double l) {
   }
 }
 
-void initialize_velocities(double *vx, double *vy, double *theta, int n) {
+void initialize_velocities(double *vx, double *vy, double *theta, int n, double v0) {
   for (int i = 0; i < n; i++) {
     theta[i] = 2 * M_PI * ((double) rand() / RAND_MAX);
-    vx[i] = V0 * cos(theta[i]);
-    vy[i] = V0 * sin(theta[i]);
+    vx[i] = v0 * cos(theta[i]);
+    vy[i] = v0 * sin(theta[i]);
   }
 }
 
@@ -46,32 +46,33 @@ void update_positions(double *x, double *y, double *vx, double *vy, int n, doubl
 }
 
 void calculate_mean_theta(double *mean_theta, double *theta, double *x, double *y, int n, double r) {
-  for (int b = 0; b < n; b++) {
-    double sx = 0.0, sy = 0.0;
-    double *cos_theta = (double *)malloc(n * sizeof(double));
-    double *sin_theta = (double *)malloc(n * sizeof(double));
+  double *cos_theta = (double *)malloc(n * sizeof(double));
+  double *sin_theta = (double *)malloc(n * sizeof(double));
+  double *in_range = (double *)malloc(n * sizeof(double));
 
+  for (int i = 0; i < n; i++) {
+    cos_theta[i] = cos(theta[i]);
+    sin_theta[i] = sin(theta[i]);
+  }
+
+  for (int b = 0; b < n; b++) {
+    // 1 for the neighbours of b and 0 otherwise, so the dot products sum over neighbours only
     for (int i = 0; i < n; i++) {
       double dx = x[i] - x[b];
       double dy = y[i] - y[b];
-      if (dx * dx + dy * dy < r * r) {
-        cos_theta[i] = cos(theta[i]);
-        sin_theta[i] = sin(theta[i]);
-      } else {
-        cos_theta[i] = 0.0;
-        sin_theta[i] = 0.0;
-      }
+      in_range[i] = (dx * dx + dy * dy < r * r) ? 1.0 : 0.0;
     }
 
-    sx = cblas_ddot(n, cos_theta, 1, theta, 1);
-    sy = cblas_ddot(n, sin_theta, 1, theta, 1);
-
-    free(cos_theta);
-    free(sin_theta);
-
+    double sx = cblas_ddot(n, in_range, 1, cos_theta, 1);
+    double sy = cblas_ddot(n, in_range, 1, sin_theta, 1);
     mean_theta[b] = atan2(sy, sx);
   }
+
+  free(cos_theta);
+  free(sin_theta);
+  free(in_range);
 }
+
 void calculate_mean_theta_original(double *mean_theta, double *theta, double *x, double *y, int n, double r) {
   for (int b = 0; b < n; b++) {
     double sx = 0.0, sy = 0.0;
@@ -87,38 +88,43 @@ void calculate_mean_theta_original(double *mean_theta, double *theta, double *x,
   }
 }
 
-void update_theta(double *theta, double *mean_theta, int n) {
+void update_theta(double *theta, double *mean_theta, int n, double eta) {
   for (int b = 0; b < n; b++) {
-    theta[b] = mean_theta[b] + ETA * (((double) rand() / RAND_MAX) - 0.5);
+    theta[b] = mean_theta[b] + eta * (((double) rand() / RAND_MAX) - 0.5);
   }
 }
 
-void update_velocities(double *vx, double *vy, double *theta, int n) {
+void update_velocities(double *vx, double *vy, double *theta, int n, double v0) {
   for (int b = 0; b < n; b++) {
-    vx[b] = V0 * cos(theta[b]);
-    vy[b] = V0 * sin(theta[b]);
+    vx[b] = v0 * cos(theta[b]);
+    vy[b] = v0 * sin(theta[b]);
   }
 }
 
 int main(int argc, char **argv) {
-  int n = parse_n(argc, argv);
+  sim_params p = parse_params(argc, argv);
+  int n = p.n;
 
-  srand(time(NULL));
+  srand(1);
 
   double x[n], y[n], vx[n], vy[n], theta[n], mean_theta[n];
 
-  initialize_positions(x, y, n, L);
-  initialize_velocities(vx, vy, theta, n);
+  // Same seed and order as the other backends, so all of them simulate the same flock
+  initialize_velocities(vx, vy, theta, n, p.v0);
+  initialize_positions(x, y, n, p.l);
+
+  output_stage *output = open_output(&p);
 
   double t_start = get_time_ns();
-  for (int t = 0; t < NT; t++) {
-    update_positions(x, y, vx, vy, n, DT);
-    apply_periodic_boundary_conditions(x, y, n, L);
-    calculate_mean_theta(mean_theta, theta, x, y, n, R);
-    update_theta(theta, mean_theta, n);
-    update_velocities(vx, vy, theta, n);
-    if (PRINT) print_flock_positions(t, x, y, vx, vy, n);
+  for (int t = 0; t < p.nt; t++) {
+    update_positions(x, y, vx, vy, n, p.dt);
+    apply_periodic_boundary_conditions(x, y, n, p.l);
+    calculate_mean_theta(mean_theta, theta, x, y, n, p.r);
+    update_theta(theta, mean_theta, n, p.eta);
+    update_velocities(vx, vy, theta, n, p.v0);
+    if (output) output_frame(output, t, x, y, theta);
   }
+  close_output(output);
   double t_end = get_time_ns();
   print_time(time_to_unit(t_end - t_start, "ns", TIME_UNIT), TIME_UNIT);
 
@@ -0,0 +1,69 @@
+/* Cell list based implementation of bird flocking simulation */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "./utils.h"
+#include "./params.h"
+#include "./cells_kernel.h"
+
+/**
+ * @brief Main function to simulate bird flocking with a cell list.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return int Exit status.
+ */
+int main(int argc, char **argv) {
+  // Parse the simulation parameters from command line arguments
+  sim_params p = parse_params(argc, argv);
+  int n = p.n;
+  srand(1);
+
+  // Arrays for positions, velocities, and angles (on the heap, as this backend targets large flocks)
+  double *x = malloc(n * sizeof(double)), *y = malloc(n * sizeof(double));
+  double *vx = malloc(n * sizeof(double)), *vy = malloc(n * sizeof(double));
+  double *theta = malloc(n * sizeof(double)), *mean_theta = malloc(n * sizeof(double));
+  if (x == NULL || y == NULL || vx == NULL || vy == NULL || theta == NULL || mean_theta == NULL) {
+    fprintf(stderr, "Failed to allocate the arrays for %d birds\n", n);
+    return 1;
+  }
+
+  // Record the start time
+  double t_start = get_time_ns();
+
+  // Initialize velocities and positions, then bin the birds once
+  initialize_velocities(vx, vy, theta, n, p.v0);
+  initialize_positions(x, y, n, p.l);
+  cell_list cells;
+  double *gathered = NULL;
+  if (cell_list_init(&cells, x, y, n, p.l, p.r) != 0 ||
+      (gathered = malloc(4 * cells.pool_cap * sizeof(double))) == NULL) {
+    fprintf(stderr, "Failed to allocate the cell list\n");
+    cell_list_free(&cells);
+    return 1;
+  }
+
+  // Open the trajectory output, if any
+  output_stage *output = open_output(&p);
+
+  // Main simulation loop
+  for (int t = 0; t < p.nt; t++) {
+    simulation_step(x, y, vx, vy, theta, mean_theta, gathered, n, &cells, p.dt, p.eta, p.v0, p.r, p.l);
+    if (output) output_frame(output, t, x, y, theta);
+  }
+  // Finish the output; a pipeline may still be writing the last steps
+  close_output(output);
+
+  // Record the end time and print the elapsed time
+  double t_end = get_time_ns();
+  print_time(time_to_unit(t_end - t_start, "ns", TIME_UNIT), TIME_UNIT);
+  printf("Cell moves per step: %.1f (%.2f%% of birds), defragmentations: %ld\n",
+         (double) cells.n_moves / (p.nt > 0 ? p.nt : 1),
+         100.0 * cells.n_moves / ((double) (p.nt > 0 ? p.nt : 1) * (n > 0 ? n : 1)),
+         cells.n_defrags);
+
+  cell_list_free(&cells);
+  free(x); free(y); free(vx); free(vy); free(theta); free(mean_theta); free(gathered);
+  return 0;
+}
@@ -28,12 +28,13 @@ void initialize_positions(double *x, double *y, int n, double l) {
  * @param vy Pointer to the array of y components of velocity.
  * @param theta Pointer to the array of angles representing the direction of velocity.
  * @param n Number of birds.
+ * @param v0 Speed of each bird.
  */
-void initialize_velocities(double *vx, double *vy, double *theta, int n) {
+void initialize_velocities(double *vx, double *vy, double *theta, int n, double v0) {
   for (int i = 0; i < n; i++) {
     theta[i] = 2 * M_PI * ((double) rand() / RAND_MAX);
-    vx[i] = V0 * cos(theta[i]);
-    vy[i] = V0 * sin(theta[i]);
+    vx[i] = v0 * cos(theta[i]);
+    vy[i] = v0 * sin(theta[i]);
   }
 }
 
@@ -45,7 +46,7 @@ void initialize_velocities(double *vx, double *vy, double *theta, int n) {
  * @param n Number of birds.
  * @param l Side length of the square.
  */
-void apply_periodic_boundary_conditions(double *x, double *y, int n, double l) {
+KERNEL_INLINE void apply_periodic_boundary_conditions(double *x, double *y, int n, double l) {
   for (int i = 0; i < n; i++) {
     x[i] = fmod(x[i], l);
     y[i] = fmod(y[i], l);
@@ -81,7 +82,7 @@ void update_positions(double *x, double *y, double *vx, double *vy, int n, doubl
  * @param n Number of birds.
  * @param r Radius within which to consider neighboring birds.
  */
-void calculate_mean_theta(double *mean_theta, double *theta, double *x, double *y, int n, double r) {
+KERNEL_INLINE void calculate_mean_theta(double *mean_theta, double *theta, double *x, double *y, int n, double r) {
   for (int b = 0; b < n; b++) {
     double sx = 0.0, sy = 0.0;
     for (int i = 0; i < n; i++) {
@@ -102,10 +103,11 @@ void calculate_mean_theta(double *mean_theta, double *theta, double *x, double *
  * @param theta Pointer to the array of current directions.
  * @param mean_theta Pointer to the array of mean directions.
  * @param n Number of birds.
+ * @param eta Noise parameter affecting the change in direction.
  */
-void update_theta(double *theta, double *mean_theta, int n) {
+void update_theta(double *theta, double *mean_theta, int n, double eta) {
   for (int b = 0; b < n; b++) {
-    theta[b] = mean_theta[b] + ETA * (((double) rand() / RAND_MAX) - 0.5);
+    theta[b] = mean_theta[b] + eta * (((double) rand() / RAND_MAX) - 0.5);
   }
 }
 
@@ -116,14 +118,41 @@ void update_theta(double *theta, double *mean_theta, int n) {
  * @param vy Pointer to the array of y components of velocity.
  * @param theta Pointer to the array of current directions.
  * @param n Number of birds.
+ * @param v0 Speed of each bird.
  */
-void update_velocities(double *vx, double *vy, double *theta, int n) {
+void update_velocities(double *vx, double *vy, double *theta, int n, double v0) {
   for (int b = 0; b < n; b++) {
-    vx[b] = V0 * cos(theta[b]);
-    vy[b] = V0 * sin(theta[b]);
+    vx[b] = v0 * cos(theta[b]);
+    vy[b] = v0 * sin(theta[b]);
   }
 }
 
+/**
+ * @brief Advances the simulation by one time step.
+ * 
+ * @param x Pointer to the array of x coordinates.
+ * @param y Pointer to the array of y coordinates.
+ * @param vx Pointer to the array of x components of velocity.
+ * @param vy Pointer to the array of y components of velocity.
+ * @param theta Pointer to the array of current directions.
+ * @param mean_theta Pointer to the array of mean directions.
+ * @param n Number of birds.
+ * @param p Simulation parameters.
+ * @param r Radius within which to consider neighboring birds (a constant in specialised copies).
+ * @param l Side length of the square (a constant in specialised copies).
+ */
+KERNEL_INLINE void simulation_step_impl(double *x, double *y, double *vx, double *vy, double *theta, double *mean_theta, int n, const sim_params *p, double r, double l) {
+  update_positions(x, y, vx, vy, n, p->dt);
+  apply_periodic_boundary_conditions(x, y, n, l);
+  calculate_mean_theta(mean_theta, theta, x, y, n, r);
+  update_theta(theta, mean_theta, n, p->eta);
+  update_velocities(vx, vy, theta, n, p->v0);
+}
+
+DEFINE_SPECIALISED_KERNEL(simulation_step, simulation_step_impl,
+  (double *x, double *y, double *vx, double *vy, double *theta, double *mean_theta, int n, const sim_params *p),
+  (x, y, vx, vy, theta, mean_theta, n, p))
+
 /**
  * @brief Main function to simulate bird flocking.
  * 
@@ -132,8 +161,9 @@ void update_velocities(double *vx, double *vy, double *theta, int n) {
  * @return int Exit status.
  */
 int main(int argc, char **argv) {
-  // Parse the number of birds from command line arguments
-  int n = parse_n(argc, argv);
+  // Parse the simulation parameters from command line arguments
+  sim_params p = parse_params(argc, argv);
+  int n = p.n;
   srand(1);
 
   // Arrays for positions, velocities, and angles
@@ -143,18 +173,19 @@ int main(int argc, char **argv) {
   double t_start = get_time_ns();
 
   // Initialize velocities and positions
-  initialize_velocities(vx, vy, theta, n);
-  initialize_positions(x, y, n, L);
+  initialize_velocities(vx, vy, theta, n, p.v0);
+  initialize_positions(x, y, n, p.l);
+
+  // Open the trajectory output, if any
+  output_stage *output = open_output(&p);
 
   // Main simulation loop
-  for (int t = 0; t < NT; t++) {
-    update_positions(x, y, vx, vy, n, DT);
-    apply_periodic_boundary_conditions(x, y, n, L);
-    calculate_mean_theta(mean_theta, theta, x, y, n, R);
-    update_theta(theta, mean_theta, n);
-    update_velocities(vx, vy, theta, n);
-    if (PRINT) print_flock_positions(t, x, y, vx, vy, n);
+  for (int t = 0; t < p.nt; t++) {
+    simulation_step(x, y, vx, vy, theta, mean_theta, n, &p, p.r, p.l);
+    if (output) output_frame(output, t, x, y, theta);
   }
+  // Finish the output; a pipeline may still be writing the last steps
+  close_output(output);
 
   // Record the end time and print the elapsed time
   double t_end = get_time_ns();
@@ -27,12 +27,13 @@ void initialize_positions(double *x, double *y, int n, double l) {
  * @param vy Pointer to the array of y components of velocity.
  * @param theta Pointer to the array of angles representing the direction of velocity.
  * @param n Number of birds.
+ * @param v0 Speed of each bird.
  */
-void initialize_velocities(double *vx, double *vy, double *theta, int n) {
+void initialize_velocities(double *vx, double *vy, double *theta, int n, double v0) {
     for (int i = 0; i < n; i++) {
         theta[i] = 2 * M_PI * ((double) rand() / RAND_MAX);
-        vx[i] = V0 * cos(theta[i]);
-        vy[i] = V0 * sin(theta[i]);
+        vx[i] = v0 * cos(theta[i]);
+        vy[i] = v0 * sin(theta[i]);
     }
 }
 
@@ -100,15 +101,20 @@ void calculate_mean_theta(double *mean_theta, double *theta, double *x, double *
 /**
  * @brief Updates the directions (theta) of birds based on the mean directions and some noise.
  * 
+ * Every rank draws the noise of all n birds, so each bird gets the same noise
+ * no matter how the birds are split between ranks.
+ * 
  * @param theta Pointer to the array of current directions.
  * @param mean_theta Pointer to the array of mean directions.
  * @param n Number of birds.
  * @param start Index of the first bird to process.
  * @param end Index of the last bird to process.
+ * @param eta Noise parameter affecting the change in direction.
  */
-void update_theta(double *theta, double *mean_theta, int n, int start, int end) {
-    for (int b = start; b < end; b++) {
-        theta[b] = mean_theta[b] + ETA * (((double) rand() / RAND_MAX) - 0.5);
+void update_theta(double *theta, double *mean_theta, int n, int start, int end, double eta) {
+    for (int b = 0; b < n; b++) {
+        double noise = eta * (((double) rand() / RAND_MAX) - 0.5);
+        if (b >= start && b < end) theta[b] = mean_theta[b] + noise;
     }
 }
 
@@ -121,11 +127,12 @@ void update_theta(double *theta, double *mean_theta, int n, int start, int end)
  * @param n Number of birds.
  * @param start Index of the first bird to process.
  * @param end Index of the last bird to process.
+ * @param v0 Speed of each bird.
  */
-void update_velocities(double *vx, double *vy, double *theta, int n, int start, int end) {
+void update_velocities(double *vx, double *vy, double *theta, int n, int start, int end, double v0) {
     for (int b = start; b < end; b++) {
-        vx[b] = V0 * cos(theta[b]);
-        vy[b] = V0 * sin(theta[b]);
+        vx[b] = v0 * cos(theta[b]);
+        vy[b] = v0 * sin(theta[b]);
     }
 }
 
@@ -137,8 +144,9 @@ void update_velocities(double *vx, double *vy, double *theta, int n, int start,
  * @return int Exit status.
  */
 int main(int argc, char **argv) {
-    // Parse the number of birds from command line arguments
-    int n = parse_n(argc, argv);
+    // Parse the simulation parameters from command line arguments
+    sim_params p = parse_params(argc, argv);
+    int n = p.n;
     srand(1);
 
     // Arrays for positions, velocities, and angles
@@ -153,40 +161,41 @@ int main(int argc, char **argv) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
 
-    // Calculate the number of birds per process and the range each process will handle
-    int birds_per_proc = n / num_ranks;
-    int start = rank * birds_per_proc;
-    int end = (rank == num_ranks - 1) ? n : start + birds_per_proc;
+    // Split the birds as evenly as possible; the first n % num_ranks ranks take one extra
+    int counts[num_ranks], displs[num_ranks];
+    for (int i = 0; i < num_ranks; i++) {
+        counts[i] = n / num_ranks + (i < n % num_ranks);
+        displs[i] = i == 0 ? 0 : displs[i - 1] + counts[i - 1];
+    }
+    int start = displs[rank];
+    int end = start + counts[rank];
 
     // Initialize positions and velocities
-    initialize_velocities(vx, vy, theta, n);
-    initialize_positions(x, y, n, L);
+    initialize_velocities(vx, vy, theta, n, p.v0);
+    initialize_positions(x, y, n, p.l);
 
-    // Allocate separate send and receive buffers for MPI
-    double local_mean_theta[birds_per_proc];
-    double local_theta[birds_per_proc];
-    double local_vx[birds_per_proc];
-    double local_vy[birds_per_proc];
+    // Only the first rank writes the trajectory
+    output_stage *output = rank == 0 ? open_output(&p) : NULL;
 
     // Main simulation loop
-    for (int t = 0; t < NT; t++) {
-        update_positions(x, y, vx, vy, n, DT);
-        apply_periodic_boundary_conditions(x, y, n, L);
-
-        // Calculate mean_theta with MPI
-        calculate_mean_theta(local_mean_theta, theta, x, y, n, R, start, end);
-        MPI_Allgather(local_mean_theta, birds_per_proc, MPI_DOUBLE, mean_theta, birds_per_proc, MPI_DOUBLE, MPI_COMM_WORLD);
+    for (int t = 0; t < p.nt; t++) {
+        update_positions(x, y, vx, vy, n, p.dt);
+        apply_periodic_boundary_conditions(x, y, n, p.l);
 
-        // Update theta and velocities with MPI
-        update_theta(local_theta, mean_theta, n, start, end);
-        update_velocities(local_vx, local_vy, local_theta, n, start, end);
+        // Each rank updates its own birds; mean_theta is only needed locally
+        calculate_mean_theta(mean_theta, theta, x, y, n, p.r, start, end);
+        update_theta(theta, mean_theta, n, start, end, p.eta);
+        update_velocities(vx, vy, theta, n, start, end, p.v0);
 
-        MPI_Allgather(local_theta, birds_per_proc, MPI_DOUBLE, theta, birds_per_proc, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Allgather(local_vx, birds_per_proc, MPI_DOUBLE, vx, birds_per_proc, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Allgather(local_vy, birds_per_proc, MPI_DOUBLE, vy, birds_per_proc, MPI_DOUBLE, MPI_COMM_WORLD);
+        // Share the updated birds in place, so every rank has the whole flock again
+        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, theta, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, vx, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, vy, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
 
-        if (PRINT) print_flock_positions(t, x, y, vx, vy, n);
+        if (output) output_frame(output, t, x, y, theta);
     }
+    // Finish the output; a pipeline may still be writing the last steps
+    close_output(output);
 
     // Record the end time and print the elapsed time
     double t_end = get_time_ns();
@@ -1,17 +1,35 @@
 #ifndef PARAMS_H
 #define PARAMS_H
 
-#define PRINT 0 // Set to 1 if you want to print flock positions during the simulation
 #define TIME_UNIT "s" // Units for timing: "s" for seconds, "ms" for milliseconds, "us" for microseconds, "ns" for nanoseconds
 
-// Simulation parameters
-#define V0 1.0 // Speed of each bird
-#define ETA 0.5 // Noise parameter affecting the change in direction
-#define L 100.0 // Size of the simulation area (length of the side of the square)
-#define R 1.0 // Radius within which birds consider their neighbors
-#define DT 0.2 // Time step for each update
-#define NT 1000 // Number of time steps to simulate
+// Default simulation parameters, all of which can be overridden at runtime (see parse_params)
+#define V0_DEFAULT 1.0 // Speed of each bird
+#define ETA_DEFAULT 0.5 // Noise parameter affecting the change in direction
+#define L_DEFAULT 100.0 // Size of the simulation area (length of the side of the square)
+#define R_DEFAULT 1.0 // Radius within which birds consider their neighbors
+#define DT_DEFAULT 0.2 // Time step for each update
+#define NT_DEFAULT 1000 // Number of time steps to simulate
 #define N_DEFAULT 5000 // Default number of birds
 
-#endif
+// Trajectory output (see trajectory.h), written when --output is given
+#define POS_PRECISION_DEFAULT 1e-3 // Positions are stored as multiples of this
+#define THETA_PRECISION_DEFAULT 1e-3 // Directions are stored as multiples of this
+#define TRAJ_KEYFRAME_INTERVAL 64 // Frames per independently decodable block
+#define PIPELINE_DEPTH_DEFAULT 0 // Snapshots in flight to the output thread (0 writes inline on the simulation thread)
+
+// (R, L) combinations that get kernels compiled for those constants (see DEFINE_SPECIALISED_KERNEL).
+// Any other R = 1 run uses a kernel with only R fixed, everything else the generic kernel.
+#define SPECIALISED_RL(X, ...) \
+  X(__VA_ARGS__, 1.0, 100.0) \
+  X(__VA_ARGS__, 1.0, 50.0) \
+  X(__VA_ARGS__, 1.0, 200.0) \
+  X(__VA_ARGS__, 2.0, 100.0)
 
+// The distinct R of SPECIALISED_RL, including 1, each with a tag for naming, for kernels that
+// depend on R alone and need a separately compiled copy per constant (see main_omp.c)
+#define SPECIALISED_R(X, ...) \
+  X(__VA_ARGS__, r1, 1.0) \
+  X(__VA_ARGS__, r2, 2.0)
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/*
+ * Step pipeline: hands immutable snapshots of the simulation to a consumer
+ * thread, so that output and analysis of step t overlap with computing step
+ * t + 1.
+ *
+ * Snapshots live in a ring of preallocated slots. The simulation copies its
+ * state into the next free slot and carries on; the consumer works through
+ * filled slots in order and frees them. When the consumer falls behind and
+ * the ring is full, the simulation waits for a slot (backpressure), and the
+ * time it waits is recorded as stall time.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timing.h"
+
+/**
+ * @brief Snapshot of the simulation state after one step.
+ */
+typedef struct {
+    long step;     // Time step of the snapshot
+    size_t n;      // Number of birds
+    double *x;     // x positions
+    double *y;     // y positions
+    double *theta; // Directions of velocity
+} pipeline_frame;
+
+/**
+ * @brief Work done on every snapshot, on the consumer thread. Returns 0 on success, -1 on error.
+ */
+typedef int (*pipeline_consumer)(const pipeline_frame *frame, void *arg);
+
+/**
+ * @brief A running pipeline.
+ */
+typedef struct {
+    int capacity;              // Number of slots in the ring
+    pipeline_frame *slots;
+    double *storage;           // Arrays of all slots, allocated once
+    int head;                  // Next slot the simulation fills
+    int tail;                  // Next slot the consumer reads
+    int count;                 // Filled slots
+    int closed;                // Set once no more snapshots will come
+    pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+    pthread_t thread;
+    pipeline_consumer consume;
+    void *arg;
+    double stall_ns;           // Time the simulation waited for a free slot
+    double copy_ns;            // Time the simulation spent copying its state into slots
+    long stalls;               // Number of pushes that had to wait
+    long frames;               // Number of snapshots pushed
+    int error;                 // Set by the consumer thread once a snapshot failed; read after pipeline_finish
+} pipeline;
+
+/**
+ * @brief Body of the consumer thread.
+ *
+ * @param arg The pipeline.
+ * @return NULL.
+ */
+void *pipeline_run(void *arg) {
+    pipeline *pl = arg;
+    pthread_mutex_lock(&pl->lock);
+    for (;;) {
+        while (pl->count == 0 && !pl->closed) {
+            pthread_cond_wait(&pl->not_empty, &pl->lock);
+        }
+        if (pl->count == 0) break; // Closed and drained
+
+        // The slot belongs to the consumer until it is released below
+        pipeline_frame *frame = &pl->slots[pl->tail];
+        pthread_mutex_unlock(&pl->lock);
+        if (pl->consume(frame, pl->arg) != 0) pl->error = -1;
+        pthread_mutex_lock(&pl->lock);
+
+        pl->tail = (pl->tail + 1) % pl->capacity;
+        pl->count--;
+        pthread_cond_signal(&pl->not_full);
+    }
+    pthread_mutex_unlock(&pl->lock);
+    return NULL;
+}
+
+/**
+ * @brief Allocate the ring and start the consumer thread.
+ *
+ * @param pl The pipeline to start.
+ * @param n Number of birds.
+ * @param capacity Number of snapshots that can be in flight.
+ * @param consume Work done on every snapshot.
+ * @param arg Passed on to consume.
+ * @return 0 on success, -1 on error.
+ */
+int pipeline_start(pipeline *pl, size_t n, int capacity, pipeline_consumer consume, void *arg) {
+    memset(pl, 0, sizeof(pipeline));
+    pl->capacity = capacity > 0 ? capacity : 1;
+    pl->consume = consume;
+    pl->arg = arg;
+    pl->slots = calloc(pl->capacity, sizeof(pipeline_frame));
+    pl->storage = malloc(3 * pl->capacity * (n > 0 ? n : 1) * sizeof(double));
+    if (pl->slots == NULL || pl->storage == NULL) {
+        free(pl->slots);
+        free(pl->storage);
+        return -1;
+    }
+
+    for (int s = 0; s < pl->capacity; s++) {
+        pl->slots[s].n = n;
+        pl->slots[s].x = pl->storage + 3 * s * n;
+        pl->slots[s].y = pl->storage + (3 * s + 1) * n;
+        pl->slots[s].theta = pl->storage + (3 * s + 2) * n;
+    }
+
+    pthread_mutex_init(&pl->lock, NULL);
+    pthread_cond_init(&pl->not_full, NULL);
+    pthread_cond_init(&pl->not_empty, NULL);
+    if (pthread_create(&pl->thread, NULL, pipeline_run, pl) != 0) {
+        free(pl->slots);
+        free(pl->storage);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Snapshot the state into the ring, waiting for a free slot if the consumer is behind.
+ *
+ * @param pl The pipeline.
+ * @param step The time step of the state.
+ * @param x The array of x positions.
+ * @param y The array of y positions.
+ * @param theta The array of directions.
+ */
+void pipeline_push(pipeline *pl, long step, const double *x, const double *y, const double *theta) {
+    pthread_mutex_lock(&pl->lock);
+    if (pl->count == pl->capacity) {
+        double t_wait = get_time_ns();
+        while (pl->count == pl->capacity) {
+            pthread_cond_wait(&pl->not_full, &pl->lock);
+        }
+        pl->stall_ns += get_time_ns() - t_wait;
+        pl->stalls++;
+    }
+    pipeline_frame *frame = &pl->slots[pl->head];
+    pthread_mutex_unlock(&pl->lock);
+
+    // Only the simulation writes to the head slot, and the consumer does not see it yet
+    double t_copy = get_time_ns();
+    frame->step = step;
+    memcpy(frame->x, x, frame->n * sizeof(double));
+    memcpy(frame->y, y, frame->n * sizeof(double));
+    memcpy(frame->theta, theta, frame->n * sizeof(double));
+    pl->copy_ns += get_time_ns() - t_copy;
+
+    pthread_mutex_lock(&pl->lock);
+    pl->head = (pl->head + 1) % pl->capacity;
+    pl->count++;
+    pl->frames++;
+    pthread_cond_signal(&pl->not_empty);
+    pthread_mutex_unlock(&pl->lock);
+}
+
+/**
+ * @brief Wait for the consumer to process every snapshot, then stop it and free the ring.
+ *
+ * @param pl The pipeline.
+ */
+void pipeline_finish(pipeline *pl) {
+    pthread_mutex_lock(&pl->lock);
+    pl->closed = 1;
+    pthread_cond_signal(&pl->not_empty);
+    pthread_mutex_unlock(&pl->lock);
+    pthread_join(pl->thread, NULL);
+
+    pthread_mutex_destroy(&pl->lock);
+    pthread_cond_destroy(&pl->not_full);
+    pthread_cond_destroy(&pl->not_empty);
+    free(pl->slots);
+    free(pl->storage);
+}
+
+#endif
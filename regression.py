@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""Correctness and performance regression suite for the simulation backends.
+
+Correctness: every backend runs a few steps of fixed workloads with the same
+seed, and each frame is compared against c_dumb, the reference, within a
+tolerance. The embedding library (activematter.Simulation) is checked the
+same way as the "lib" backend. A backend that crashes fails its workload. Performance: fixed workloads are timed (best of several runs) and
+compared against a baseline stored in bench_baseline.txt; a backend fails
+when it gets slower than the baseline by more than the threshold. Workloads
+missing from the baseline (all of them on the first run on a machine) are
+only recorded.
+
+Usage (after `make`):
+    python3 regression.py                  # both checks
+    python3 regression.py --correctness    # oracle only
+    python3 regression.py --performance    # benchmark only
+    python3 regression.py --update-baseline
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+
+from activematter import Simulation, Trajectory
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+BUILD = os.path.join(ROOT, "build")
+BASELINE = os.path.join(ROOT, "bench_baseline.txt")
+
+MPI_RANKS = 3  # Does not divide most workloads, to cover uneven splits
+BACKENDS = ["dumb", "omp", "blas", "cells", "mpi", "lib"]
+REFERENCE = "dumb"
+
+# (name, extra arguments); every correctness workload runs for CHECK_STEPS steps.
+# The arguments must also be Simulation parameters, for the lib backend.
+CHECK_STEPS = 10
+CHECK_WORKLOADS = [
+    ("default", ["1001"]),
+    ("dense", ["2000", "--l", "20"]),
+    ("generic", ["500", "--r", "1.5", "--l", "30", "--eta", "0.3"]),
+]
+# Stored precision of the compared trajectories and the accepted difference
+PRECISION = 1e-7
+TOLERANCE = 1e-5
+
+# (backend, birds, steps) timed by the performance check
+BENCH_WORKLOADS = [
+    ("dumb", 2000, 100),
+    ("omp", 2000, 100),
+    ("blas", 2000, 100),
+    ("mpi", 2000, 100),
+    ("cells", 20000, 100),
+]
+BENCH_REPEATS = 5
+
+
+def command(backend, args):
+    exe = os.path.join(BUILD, f"c_{backend}")
+    if backend != "mpi":
+        return [exe] + args
+    mpirun = ["mpirun", "--oversubscribe", "-np", str(MPI_RANKS)]
+    if hasattr(os, "geteuid") and os.geteuid() == 0:
+        mpirun.insert(1, "--allow-run-as-root")
+    return mpirun + [exe] + args
+
+
+def run(backend, args):
+    """Run a backend and return the slowest reported time in seconds."""
+    result = subprocess.run(command(backend, args), capture_output=True, text=True)
+    if result.returncode != 0:
+        last = result.stderr.strip().splitlines()[-1:] or ["no output"]
+        raise RuntimeError(f"c_{backend} exited with status {result.returncode}: {last[0]}")
+    # Every MPI rank reports its own time
+    times = [float(line.split()[1]) for line in result.stdout.splitlines() if line.startswith("Time:")]
+    return max(times)
+
+
+def read_frames(path):
+    with Trajectory(path) as trajectory:
+        return [trajectory.read(k) for k in range(len(trajectory))], trajectory.l
+
+
+def simulate_library(args, steps):
+    """Step activematter.Simulation with the parameters of a workload; return its frames and l."""
+    n, options = int(args[0]), args[1:]
+    params = {key[2:]: float(value) for key, value in zip(options[::2], options[1::2])}
+    sim = Simulation(n, seed=1, **params)
+    frames = []
+    for step in range(steps):
+        sim.step()
+        frames.append((step, sim.x.copy(), sim.y.copy(), sim.theta.copy()))
+    return frames, sim.params.l
+
+
+def backend_frames(backend, args, path):
+    """Run CHECK_STEPS steps of a workload on a backend; return its frames and l."""
+    if backend == "lib":
+        return simulate_library(args, CHECK_STEPS)
+    run(backend, args + ["--nt", str(CHECK_STEPS), "--precision", str(PRECISION),
+                         "--theta_precision", str(PRECISION), "--output", path])
+    return read_frames(path)
+
+
+def max_difference(frames, reference, l):
+    """Largest difference in x, y (across the periodic box) or theta (modulo 2 pi)."""
+    worst = 0.0
+    for (_, x, y, theta), (_, rx, ry, rtheta) in zip(frames, reference):
+        for a, b, period in ((x, rx, l), (y, ry, l), (theta, rtheta, 2 * np.pi)):
+            d = np.abs(a - b) % period
+            worst = max(worst, float(np.max(np.minimum(d, period - d))))
+    return worst
+
+
+def check_correctness(backends):
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, args in CHECK_WORKLOADS:
+            try:
+                reference, l = backend_frames(REFERENCE, args, os.path.join(tmp, f"{name}-{REFERENCE}.amt"))
+            except (RuntimeError, OSError, ValueError) as error:
+                reference, reference_error = None, error
+            for backend in backends:
+                if backend == REFERENCE:
+                    continue
+                try:
+                    if reference is None:
+                        raise RuntimeError(f"reference failed: {reference_error}")
+                    frames, _ = backend_frames(backend, args, os.path.join(tmp, f"{name}-{backend}.amt"))
+                except (RuntimeError, OSError, ValueError) as error:
+                    status, detail = "FAIL", error
+                else:
+                    if len(frames) != len(reference):
+                        status, detail = "FAIL", f"{len(frames)} frames, expected {len(reference)}"
+                    else:
+                        diff = max_difference(frames, reference, l)
+                        status = "ok" if diff <= TOLERANCE else "FAIL"
+                        detail = f"max difference {diff:.2e}"
+                failures += status != "ok"
+                print(f"{status:4} correctness {backend:6} {name:8} {detail}")
+    return failures
+
+
+def load_baseline():
+    baseline = {}
+    if os.path.exists(BASELINE):
+        with open(BASELINE) as f:
+            for line in f:
+                if line.strip() and not line.startswith("#"):
+                    backend, n, nt, seconds = line.split()
+                    baseline[(backend, int(n), int(nt))] = float(seconds)
+    return baseline
+
+
+def check_performance(backends, threshold, update):
+    baseline = load_baseline()
+    measured = {}
+    failures = 0
+    for backend, n, nt in BENCH_WORKLOADS:
+        if backend not in backends:
+            continue
+        try:
+            seconds = min(run(backend, [str(n), "--nt", str(nt)]) for _ in range(BENCH_REPEATS))
+        except RuntimeError as error:
+            failures += 1
+            print(f"FAIL performance {backend:6} n={n:<6} nt={nt:<4} {error}")
+            continue
+        measured[(backend, n, nt)] = seconds
+        throughput = n * nt / seconds
+        previous = baseline.get((backend, n, nt))
+        if update or previous is None:
+            status, detail = "new", "no baseline" if previous is None else f"baseline {previous:.4f} s"
+        else:
+            ratio = seconds / previous
+            status = "ok" if ratio <= 1 + threshold else "FAIL"
+            detail = f"{ratio:.2f}x baseline {previous:.4f} s"
+        failures += status == "FAIL"
+        print(f"{status:4} performance {backend:6} n={n:<6} nt={nt:<4} {seconds:.4f} s "
+              f"({throughput:.3g} bird-steps/s) {detail}")
+
+    # Workloads without a baseline are recorded; existing entries change only on --update-baseline
+    recorded = measured if update else {key: t for key, t in measured.items() if key not in baseline}
+    if recorded:
+        baseline.update(recorded)
+        with open(BASELINE, "w") as f:
+            f.write("# backend birds steps seconds (best of %d), written by regression.py\n" % BENCH_REPEATS)
+            for (backend, n, nt), seconds in sorted(baseline.items()):
+                f.write(f"{backend} {n} {nt} {seconds:.6f}\n")
+        print(f"Baseline for {len(recorded)} workload(s) written to {BASELINE}")
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--correctness", action="store_true", help="only run the correctness oracle")
+    parser.add_argument("--performance", action="store_true", help="only run the benchmark")
+    parser.add_argument("--update-baseline", action="store_true", help="store the measured times as the new baseline")
+    parser.add_argument("--threshold", type=float, default=0.3,
+                        help="allowed slowdown relative to the baseline (default 0.3, i.e. 30%%)")
+    parser.add_argument("--backends", nargs="+", default=BACKENDS, choices=BACKENDS)
+    args = parser.parse_args()
+
+    backends = list(args.backends)
+    if "mpi" in backends and shutil.which("mpirun") is None:
+        print("skip mpi: mpirun not found")
+        backends.remove("mpi")
+
+    both = not args.correctness and not args.performance
+    failures = 0
+    if args.correctness or both:
+        failures += check_correctness(backends)
+    if args.performance or both or args.update_baseline:
+        failures += check_performance(backends, args.threshold, args.update_baseline)
+
+    print(f"{failures} failure(s)")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,17 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <time.h>
+
+/**
+ * @brief Get the current time in nanoseconds.
+ * 
+ * @return The current time in nanoseconds.
+ */
+double get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,534 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+/*
+ * Compressed trajectory files.
+ *
+ * Only x, y and theta are stored (velocities follow from theta). Every value is
+ * quantised to a fixed precision and stored as the zig-zag varint of its
+ * difference to a prediction: the previous frame for theta, and the previous
+ * frame plus the previous displacement for positions (birds move at constant
+ * speed, so this leaves only the change of direction). Displacements take the
+ * shorter way round the periodic box. Frames are grouped into blocks that start with a keyframe
+ * holding absolute values, and each block is deflated on its own, so a reader
+ * can seek to any frame by decoding at most one block.
+ *
+ * Layout (native byte order):
+ *   header: "AMTRAJ1\0", u64 n, f64 l, f64 pos_precision, f64 theta_precision, u32 keyframe_interval
+ *   block:  u32 n_frames, u32 raw_size, u32 packed_size, packed_size bytes of deflate data
+ *   frame:  varint step, then n x residuals, n y residuals, n theta residuals
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
+
+#define TRAJ_MAGIC "AMTRAJ1"
+#define TRAJ_MAX_VARINT 10 // Maximum bytes of one varint
+#define TRAJ_MAX_RESIDUAL 5 // Maximum bytes of one residual: differences of int32 values need at most 34 bits zig-zagged
+
+/**
+ * @brief State of a trajectory being written.
+ */
+typedef struct {
+    FILE *f;
+    size_t n;                // Number of birds
+    int64_t period;          // Box size in position quanta
+    double pos_scale;        // Inverse of the position precision
+    double theta_scale;      // Inverse of the theta precision
+    int keyframe_interval;   // Frames per block
+    int block_frames;        // Frames in the current block
+    int32_t *prev;           // Quantised x, y and theta of the previous frame
+    int32_t *velocity;       // Quantised x and y displacement into the previous frame
+    unsigned char *raw;      // Encoded frames of the current block
+    size_t raw_len;
+    unsigned char *packed;   // Deflated block
+    size_t packed_cap;
+    int failed;              // Set once a write failed; later frames are refused
+} traj_writer;
+
+/**
+ * @brief State of a trajectory being read (opaque in activematter.h).
+ */
+typedef struct traj_reader {
+    FILE *f;
+    size_t n;                // Number of birds
+    double l;                // Side length of the square
+    double pos_precision;    // Size of one position quantum
+    double theta_precision;  // Size of one theta quantum
+    int keyframe_interval;   // Frames per block
+    int64_t period;          // Box size in position quanta
+    size_t n_frames;         // Total number of frames
+    size_t n_blocks;         // Number of blocks
+    long *block_offset;      // File offset of each block header
+    long cached_block;       // Block currently held in raw, or -1
+    size_t next_frame;       // Frame that the cursor decodes next
+    const unsigned char *cursor; // Position of next_frame within raw
+    int32_t *current;        // Quantised x, y and theta of frame next_frame - 1
+    int32_t *velocity;       // Quantised x and y displacement into frame next_frame - 1
+    long current_step;       // Step of frame next_frame - 1
+    unsigned char *raw;
+    size_t raw_cap;
+    unsigned char *packed;
+    size_t packed_cap;
+} traj_reader;
+
+/**
+ * @brief Append a zig-zag encoded varint to a buffer.
+ *
+ * @param p Where to write.
+ * @param v The signed value.
+ * @return The position after the written bytes.
+ */
+unsigned char *traj_put_varint(unsigned char *p, int64_t v) {
+    uint64_t u = ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+    while (u >= 0x80) {
+        *p++ = (unsigned char) (u | 0x80);
+        u >>= 7;
+    }
+    *p++ = (unsigned char) u;
+    return p;
+}
+
+/**
+ * @brief Read a zig-zag encoded varint from a buffer.
+ *
+ * @param p Pointer to the read position, advanced past the varint.
+ * @return The signed value.
+ */
+int64_t traj_get_varint(const unsigned char **p) {
+    uint64_t u = 0;
+    int shift = 0;
+    const unsigned char *q = *p;
+    while (*q & 0x80) {
+        u |= (uint64_t) (*q++ & 0x7f) << shift;
+        shift += 7;
+    }
+    u |= (uint64_t) *q++ << shift;
+    *p = q;
+    return (int64_t) (u >> 1) ^ -(int64_t) (u & 1);
+}
+
+/**
+ * @brief Wrap a quantised position into [0, period).
+ *
+ * @param q The quantised position.
+ * @param period Box size in position quanta.
+ * @return The wrapped position.
+ */
+int64_t traj_wrap(int64_t q, int64_t period) {
+    q %= period;
+    return q < 0 ? q + period : q;
+}
+
+/**
+ * @brief Check that a trajectory with these precisions fits its int32 quantised state.
+ *
+ * The box must be at least one and at most INT32_MAX position quanta wide, and
+ * a full turn at most INT32_MAX direction quanta.
+ *
+ * @param l Side length of the square.
+ * @param pos_precision Size of one position quantum.
+ * @param theta_precision Size of one theta quantum.
+ * @return 0 if the precisions are usable, -1 otherwise.
+ */
+int traj_check_precision(double l, double pos_precision, double theta_precision) {
+    if (!(pos_precision > 0 && theta_precision > 0)) return -1;
+    double period = l / pos_precision;
+    double turn = 2 * M_PI / theta_precision;
+    return period >= 1 && period <= INT32_MAX && turn <= INT32_MAX ? 0 : -1;
+}
+
+/**
+ * @brief Create a trajectory file.
+ *
+ * @param path The path of the file.
+ * @param n Number of birds.
+ * @param l Side length of the square.
+ * @param pos_precision Size of one position quantum.
+ * @param theta_precision Size of one theta quantum.
+ * @param keyframe_interval Number of frames per block.
+ * @return The writer, or NULL on error (including precisions rejected by traj_check_precision,
+ *         and blocks too large for their u32 size fields).
+ */
+traj_writer *traj_open_writer(const char *path, size_t n, double l, double pos_precision, double theta_precision, int keyframe_interval) {
+    if (traj_check_precision(l, pos_precision, theta_precision) != 0) {
+        fprintf(stderr, "Trajectory precision out of range for l = %g: precision %g, theta_precision %g\n",
+                l, pos_precision, theta_precision);
+        return NULL;
+    }
+
+    // All buffers are sized for a full block up front, so writing a frame never allocates
+    if (keyframe_interval < 1) keyframe_interval = 1;
+    size_t raw_cap = (size_t) keyframe_interval * (TRAJ_MAX_VARINT + 3 * n * TRAJ_MAX_RESIDUAL);
+    if (compressBound(raw_cap) > UINT32_MAX) {
+        // Block sizes are stored as u32
+        fprintf(stderr, "Too many birds for a trajectory with %d frames per block: %zu\n", keyframe_interval, n);
+        return NULL;
+    }
+
+    traj_writer *w = calloc(1, sizeof(traj_writer));
+    if (w == NULL) return NULL;
+    w->f = fopen(path, "wb");
+    if (w->f == NULL) {
+        fprintf(stderr, "Cannot open trajectory file: %s\n", path);
+        free(w);
+        return NULL;
+    }
+
+    w->n = n;
+    w->period = llround(l / pos_precision);
+    w->pos_scale = 1.0 / pos_precision;
+    w->theta_scale = 1.0 / theta_precision;
+    w->keyframe_interval = keyframe_interval;
+    w->packed_cap = compressBound(raw_cap);
+    w->prev = malloc(3 * (n > 0 ? n : 1) * sizeof(int32_t));
+    w->velocity = malloc(2 * (n > 0 ? n : 1) * sizeof(int32_t));
+    w->raw = malloc(raw_cap);
+    w->packed = malloc(w->packed_cap);
+    if (w->prev == NULL || w->velocity == NULL || w->raw == NULL || w->packed == NULL) {
+        fclose(w->f);
+        free(w->prev); free(w->velocity); free(w->raw); free(w->packed); free(w);
+        return NULL;
+    }
+
+    uint64_t n64 = n;
+    uint32_t interval = w->keyframe_interval;
+    char magic[8] = TRAJ_MAGIC;
+    fwrite(magic, 1, sizeof(magic), w->f);
+    fwrite(&n64, sizeof(n64), 1, w->f);
+    fwrite(&l, sizeof(l), 1, w->f);
+    fwrite(&pos_precision, sizeof(pos_precision), 1, w->f);
+    fwrite(&theta_precision, sizeof(theta_precision), 1, w->f);
+    fwrite(&interval, sizeof(interval), 1, w->f);
+    return w;
+}
+
+/**
+ * @brief Compress the current block and write it to the file.
+ *
+ * @param w The writer.
+ * @return 0 on success, -1 on error.
+ */
+int traj_flush_block(traj_writer *w) {
+    if (w->block_frames == 0) return 0;
+
+    uLongf packed_len = w->packed_cap;
+    if (compress2(w->packed, &packed_len, w->raw, w->raw_len, Z_BEST_SPEED) != Z_OK) {
+        fprintf(stderr, "Failed to compress trajectory block\n");
+        w->failed = 1;
+        return -1;
+    }
+
+    uint32_t block_header[3] = {w->block_frames, w->raw_len, packed_len};
+    if (fwrite(block_header, sizeof(block_header), 1, w->f) != 1 ||
+        fwrite(w->packed, 1, packed_len, w->f) != packed_len) {
+        fprintf(stderr, "Failed to write trajectory block\n");
+        w->failed = 1;
+        return -1;
+    }
+
+    w->block_frames = 0;
+    w->raw_len = 0;
+    return 0;
+}
+
+/**
+ * @brief Append one frame to the trajectory.
+ *
+ * @param w The writer.
+ * @param step The time step of the frame.
+ * @param x The array of x positions, in [0, l).
+ * @param y The array of y positions, in [0, l).
+ * @param theta The array of directions.
+ * @return 0 on success, -1 on error (then and after any earlier error, nothing is written).
+ */
+int traj_write_frame(traj_writer *w, long step, const double *x, const double *y, const double *theta) {
+    if (w->failed) return -1;
+    int key = w->block_frames == 0;
+    unsigned char *p = traj_put_varint(w->raw + w->raw_len, step);
+
+    const double *values[3] = {x, y, theta};
+    for (int c = 0; c < 3; c++) {
+        int32_t *prev = w->prev + c * w->n;
+        int32_t *velocity = w->velocity + c * w->n;
+        double scale = c == 2 ? w->theta_scale : w->pos_scale;
+        for (size_t i = 0; i < w->n; i++) {
+            int64_t q = llround(values[c][i] * scale);
+            int64_t d;
+            if (key) {
+                if (c < 2) {
+                    q = traj_wrap(q, w->period);
+                    velocity[i] = 0;
+                }
+                d = q;
+            } else if (c < 2) {
+                q = traj_wrap(q, w->period);
+                // Birds crossing the boundary move a little, not a whole box
+                int64_t v = q - prev[i];
+                if (v > w->period / 2) v -= w->period;
+                else if (v < -w->period / 2) v += w->period;
+                d = v - velocity[i];
+                velocity[i] = (int32_t) v;
+            } else {
+                d = q - prev[i];
+            }
+            if (c == 2 && (q > INT32_MAX || q < -INT32_MAX)) {
+                fprintf(stderr, "Direction %g out of range for the trajectory precision\n", values[c][i]);
+                w->failed = 1;
+                return -1;
+            }
+            prev[i] = (int32_t) q;
+            p = traj_put_varint(p, d);
+        }
+    }
+
+    w->raw_len = p - w->raw;
+    if (++w->block_frames == w->keyframe_interval) {
+        return traj_flush_block(w);
+    }
+    return 0;
+}
+
+/**
+ * @brief Flush the last block and close the trajectory.
+ *
+ * @param w The writer (may be NULL).
+ * @return 0 on success, -1 if this or any earlier write failed.
+ */
+int traj_close_writer(traj_writer *w) {
+    if (w == NULL) return 0;
+    int status = w->failed ? -1 : traj_flush_block(w);
+    if (fclose(w->f) != 0) status = -1;
+    free(w->prev);
+    free(w->velocity);
+    free(w->raw);
+    free(w->packed);
+    free(w);
+    return status;
+}
+
+/**
+ * @brief Free a reader and everything it owns.
+ *
+ * @param r The reader (may be NULL).
+ */
+void traj_close_reader(traj_reader *r) {
+    if (r == NULL) return;
+    if (r->f != NULL) fclose(r->f);
+    free(r->block_offset);
+    free(r->current);
+    free(r->velocity);
+    free(r->raw);
+    free(r->packed);
+    free(r);
+}
+
+/**
+ * @brief Open a trajectory and index its blocks.
+ *
+ * A trailing block that was cut short (e.g. by a crashed run) is ignored.
+ *
+ * @param path The path of the file.
+ * @return The reader, or NULL on error.
+ */
+traj_reader *traj_open_reader(const char *path) {
+    traj_reader *r = calloc(1, sizeof(traj_reader));
+    if (r == NULL) return NULL;
+    r->f = fopen(path, "rb");
+    if (r->f == NULL) {
+        fprintf(stderr, "Cannot open trajectory file: %s\n", path);
+        free(r);
+        return NULL;
+    }
+
+    char magic[8];
+    uint64_t n64;
+    uint32_t interval;
+    if (fread(magic, 1, sizeof(magic), r->f) != sizeof(magic) || memcmp(magic, TRAJ_MAGIC, sizeof(magic)) != 0 ||
+        fread(&n64, sizeof(n64), 1, r->f) != 1 ||
+        fread(&r->l, sizeof(r->l), 1, r->f) != 1 ||
+        fread(&r->pos_precision, sizeof(r->pos_precision), 1, r->f) != 1 ||
+        fread(&r->theta_precision, sizeof(r->theta_precision), 1, r->f) != 1 ||
+        fread(&interval, sizeof(interval), 1, r->f) != 1 || interval == 0 || interval > INT32_MAX) {
+        fprintf(stderr, "Not a trajectory file: %s\n", path);
+        traj_close_reader(r);
+        return NULL;
+    }
+    r->n = n64;
+    r->keyframe_interval = interval;
+    if (traj_check_precision(r->l, r->pos_precision, r->theta_precision) != 0) {
+        fprintf(stderr, "Invalid precision in trajectory file: %s\n", path);
+        traj_close_reader(r);
+        return NULL;
+    }
+    r->period = llround(r->l / r->pos_precision);
+
+    fseek(r->f, 0, SEEK_END);
+    long file_size = ftell(r->f);
+    long offset = sizeof(magic) + sizeof(n64) + 3 * sizeof(double) + sizeof(interval);
+
+    // Walk the block headers; every block but the last holds keyframe_interval frames
+    size_t blocks_cap = 0;
+    uint32_t block_header[3];
+    while (offset + (long) sizeof(block_header) <= file_size) {
+        fseek(r->f, offset, SEEK_SET);
+        if (fread(block_header, sizeof(block_header), 1, r->f) != 1) break;
+        long next = offset + sizeof(block_header) + block_header[2];
+        if (next > file_size) break;
+
+        if (r->n_blocks == blocks_cap) {
+            blocks_cap = blocks_cap ? 2 * blocks_cap : 64;
+            long *grown = realloc(r->block_offset, blocks_cap * sizeof(long));
+            if (grown == NULL) {
+                traj_close_reader(r);
+                return NULL;
+            }
+            r->block_offset = grown;
+        }
+        r->block_offset[r->n_blocks++] = offset;
+        r->n_frames += block_header[0];
+        if (block_header[1] > r->raw_cap) r->raw_cap = block_header[1];
+        if (block_header[2] > r->packed_cap) r->packed_cap = block_header[2];
+        offset = next;
+    }
+
+    r->current = malloc(3 * (r->n > 0 ? r->n : 1) * sizeof(int32_t));
+    r->velocity = malloc(2 * (r->n > 0 ? r->n : 1) * sizeof(int32_t));
+    r->raw = malloc(r->raw_cap > 0 ? r->raw_cap : 1);
+    r->packed = malloc(r->packed_cap > 0 ? r->packed_cap : 1);
+    if (r->current == NULL || r->velocity == NULL || r->raw == NULL || r->packed == NULL) {
+        traj_close_reader(r);
+        return NULL;
+    }
+    r->cached_block = -1;
+    return r;
+}
+
+/**
+ * @brief Get the number of birds in a trajectory.
+ *
+ * @param r The reader.
+ * @return The number of birds.
+ */
+size_t traj_n(const traj_reader *r) {
+    return r->n;
+}
+
+/**
+ * @brief Get the side length of the square of a trajectory.
+ *
+ * @param r The reader.
+ * @return The side length.
+ */
+double traj_l(const traj_reader *r) {
+    return r->l;
+}
+
+/**
+ * @brief Get the number of complete frames in a trajectory.
+ *
+ * @param r The reader.
+ * @return The number of frames.
+ */
+size_t traj_n_frames(const traj_reader *r) {
+    return r->n_frames;
+}
+
+/**
+ * @brief Read and inflate one block into the reader's buffer.
+ *
+ * @param r The reader.
+ * @param block The block index.
+ * @return 0 on success, -1 on error.
+ */
+int traj_load_block(traj_reader *r, size_t block) {
+    uint32_t block_header[3];
+    fseek(r->f, r->block_offset[block], SEEK_SET);
+    if (fread(block_header, sizeof(block_header), 1, r->f) != 1 ||
+        fread(r->packed, 1, block_header[2], r->f) != block_header[2]) {
+        fprintf(stderr, "Failed to read trajectory block %zu\n", block);
+        return -1;
+    }
+
+    uLongf raw_len = r->raw_cap;
+    if (uncompress(r->raw, &raw_len, r->packed, block_header[2]) != Z_OK || raw_len != block_header[1]) {
+        fprintf(stderr, "Corrupt trajectory block %zu\n", block);
+        return -1;
+    }
+
+    r->cached_block = block;
+    r->next_frame = block * r->keyframe_interval;
+    r->cursor = r->raw;
+    return 0;
+}
+
+/**
+ * @brief Decode the frame under the cursor into the reader's current frame.
+ *
+ * @param r The reader.
+ */
+void traj_decode_frame(traj_reader *r) {
+    int key = r->next_frame % r->keyframe_interval == 0;
+    r->current_step = traj_get_varint(&r->cursor);
+    for (int c = 0; c < 3; c++) {
+        int32_t *q = r->current + c * r->n;
+        int32_t *velocity = r->velocity + c * r->n;
+        for (size_t i = 0; i < r->n; i++) {
+            int64_t d = traj_get_varint(&r->cursor);
+            if (key) {
+                q[i] = (int32_t) d;
+                if (c < 2) velocity[i] = 0;
+            } else if (c < 2) {
+                velocity[i] += (int32_t) d;
+                q[i] = (int32_t) traj_wrap(q[i] + velocity[i], r->period);
+            } else {
+                q[i] += (int32_t) d;
+            }
+        }
+    }
+    r->next_frame++;
+}
+
+/**
+ * @brief Read one frame of the trajectory.
+ *
+ * Sequential reads decode one frame each; a random read decodes from the
+ * keyframe of its block.
+ *
+ * @param r The reader.
+ * @param frame Index of the frame, in [0, n_frames).
+ * @param step Receives the time step of the frame (may be NULL).
+ * @param x Receives the n x positions.
+ * @param y Receives the n y positions.
+ * @param theta Receives the n directions.
+ * @return 0 on success, -1 on error.
+ */
+int traj_read_frame(traj_reader *r, size_t frame, long *step, double *x, double *y, double *theta) {
+    if (frame >= r->n_frames) return -1;
+
+    size_t block = frame / r->keyframe_interval;
+    if ((long) block != r->cached_block) {
+        if (traj_load_block(r, block) != 0) return -1;
+    } else if (frame + 1 < r->next_frame) {
+        // Going backwards within the block: decode again from its keyframe
+        r->next_frame = block * r->keyframe_interval;
+        r->cursor = r->raw;
+    }
+    while (r->next_frame <= frame) {
+        traj_decode_frame(r);
+    }
+
+    for (size_t i = 0; i < r->n; i++) {
+        x[i] = r->current[i] * r->pos_precision;
+        y[i] = r->current[r->n + i] * r->pos_precision;
+        theta[i] = r->current[2 * r->n + i] * r->theta_precision;
+    }
+    if (step != NULL) *step = r->current_step;
+    return 0;
+}
+
+#endif
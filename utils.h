@@ -5,36 +5,186 @@
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "params.h"
+#include "timing.h"
+#include "kernel.h"
+#include "trajectory.h"
+#include "pipeline.h"
 
 /**
- * @brief Parse the number of birds from command line arguments.
+ * @brief Runtime simulation parameters.
+ */
+typedef struct {
+    size_t n;    // Number of birds
+    double v0;   // Speed of each bird
+    double eta;  // Noise parameter affecting the change in direction
+    double l;    // Size of the simulation area
+    double r;    // Radius within which birds consider their neighbors
+    double dt;   // Time step for each update
+    int nt;      // Number of time steps to simulate
+    char output[256];        // Trajectory file to write, or empty for none
+    double precision;        // Position precision of the trajectory
+    double theta_precision;  // Direction precision of the trajectory
+    int pipeline;            // Snapshots in flight to the output thread, or 0 to write inline
+} sim_params;
+
+/**
+ * @brief Get the parameters defined in params.h.
  * 
- * @param argc The number of command line arguments.
- * @param argv The array of command line arguments.
- * @return The number of birds specified in the command line arguments or the default value.
+ * @return The default parameters.
+ */
+sim_params default_params() {
+    sim_params p = {N_DEFAULT, V0_DEFAULT, ETA_DEFAULT, L_DEFAULT, R_DEFAULT, DT_DEFAULT, NT_DEFAULT,
+                    "", POS_PRECISION_DEFAULT, THETA_PRECISION_DEFAULT, PIPELINE_DEPTH_DEFAULT};
+    return p;
+}
+
+/**
+ * @brief Check that a parsed value is a whole number that fits in an int.
+ * 
+ * @param value The parsed value.
+ * @param min The smallest accepted value.
+ * @return 1 if value is an integer in [min, INT_MAX], 0 otherwise.
+ */
+int is_count(double value, double min) {
+    return value >= min && value <= INT_MAX && value == (double)(int)value;
+}
+
+/**
+ * @brief Set one parameter by name.
+ * 
+ * Counts must be whole numbers (n at least 1, nt and pipeline at least 0),
+ * l and dt positive and r not negative.
+ * 
+ * @param p The parameters to modify.
+ * @param key The parameter name ("n", "v0", "eta", "l", "r", "dt", "nt",
+ *            "output", "precision", "theta_precision" or "pipeline").
+ * @param value The new value as text.
+ * @return 0 on success, -1 if the name is unknown or the value is invalid.
+ */
+int set_param(sim_params *p, const char *key, const char *value) {
+    if (strcmp(key, "output") == 0) {
+        if (strlen(value) >= sizeof(p->output)) return -1;
+        strcpy(p->output, value);
+        return 0;
+    }
+
+    char *endptr;
+    double parsed = strtod(value, &endptr);
+    if (endptr == value || *endptr != '\0') {
+        return -1;
+    }
+
+    if (strcmp(key, "n") == 0 && is_count(parsed, 1)) {
+        p->n = (size_t)parsed;
+    } else if (strcmp(key, "v0") == 0) {
+        p->v0 = parsed;
+    } else if (strcmp(key, "eta") == 0) {
+        p->eta = parsed;
+    } else if (strcmp(key, "l") == 0 && parsed > 0) {
+        p->l = parsed;
+    } else if (strcmp(key, "r") == 0 && parsed >= 0) {
+        p->r = parsed;
+    } else if (strcmp(key, "dt") == 0 && parsed > 0) {
+        p->dt = parsed;
+    } else if (strcmp(key, "nt") == 0 && is_count(parsed, 0)) {
+        p->nt = (int)parsed;
+    } else if (strcmp(key, "precision") == 0 && parsed > 0) {
+        p->precision = parsed;
+    } else if (strcmp(key, "theta_precision") == 0 && parsed > 0) {
+        p->theta_precision = parsed;
+    } else if (strcmp(key, "pipeline") == 0 && is_count(parsed, 0)) {
+        p->pipeline = (int)parsed;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read parameters from a config file of "key = value" lines.
+ * 
+ * Blank lines and lines starting with '#' are ignored.
+ * 
+ * @param p The parameters to modify.
+ * @param path The path of the config file.
+ * @return 0 on success, -1 if the file cannot be read or contains an invalid line.
  */
-size_t parse_n(int argc, char **argv) {
-    size_t n = N_DEFAULT;
-    if (argc >= 2) {
-        char *endptr;
-        long int parsed = strtol(argv[1], &endptr, 10);
-        if (*endptr == '\0') { // Check if conversion was successful
-            n = (size_t)parsed;
+int read_params_file(sim_params *p, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot open config file: %s\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_number++;
+        char key[64], value[64];
+        char *start = line + strspn(line, " \t");
+        if (*start == '#' || *start == '\n' || *start == '\0') continue;
+        if (sscanf(start, " %63[^= \t] = %63s", key, value) != 2 || set_param(p, key, value) != 0) {
+            fprintf(stderr, "Invalid line %d in %s: %s", line_number, path, line);
+            fclose(f);
+            return -1;
         }
     }
-    return n;
+
+    fclose(f);
+    return 0;
 }
 
 /**
- * @brief Get the current time in nanoseconds.
+ * @brief Parse the simulation parameters from command line arguments.
+ * 
+ * Accepts an optional leading number of birds, then any of
+ * "--config <file>" and "--<name> <value>" for the names known to set_param.
+ * Later arguments override earlier ones. When an output is requested, the
+ * trajectory precisions are checked against l once all arguments are read.
+ * Exits with a usage message on error.
  * 
- * @return The current time in nanoseconds.
+ * @param argc The number of command line arguments.
+ * @param argv The array of command line arguments.
+ * @return The parameters.
  */
-double get_time_ns() {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1e9 + ts.tv_nsec;
+sim_params parse_params(int argc, char **argv) {
+    sim_params p = default_params();
+    int i = 1;
+    if (argc >= 2 && strncmp(argv[1], "--", 2) != 0 && set_param(&p, "n", argv[1]) == 0) {
+        i = 2;
+    }
+
+    for (; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0 || i + 1 >= argc) {
+            break;
+        }
+        const char *value = argv[i + 1];
+        if (strcmp(arg, "--config") == 0) {
+            if (read_params_file(&p, value) != 0) exit(1);
+        } else if (set_param(&p, arg + 2, value) != 0) {
+            break;
+        }
+        i++;
+    }
+
+    // The precisions depend on l, so they can only be checked once everything is parsed
+    int bad_precision = i == argc && p.output[0] != '\0' &&
+                        traj_check_precision(p.l, p.precision, p.theta_precision) != 0;
+    if (i < argc || bad_precision) {
+        if (bad_precision) {
+            fprintf(stderr, "Invalid precision: l / precision must be in [1, %d] and 2 pi / theta_precision at most %d\n",
+                    INT32_MAX, INT32_MAX);
+        } else {
+            fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+        }
+        fprintf(stderr, "Usage: %s [n] [--config <file>] [--n|--v0|--eta|--l|--r|--dt|--nt <value>]...\n", argv[0]);
+        fprintf(stderr, "       [--output <file>] [--precision|--theta_precision|--pipeline <value>]\n");
+        exit(1);
+    }
+    return p;
 }
 
 /**
@@ -82,18 +232,101 @@ void print_time(double t, char *unit) {
 }
 
 /**
- * @brief Print the positions and velocities of the flock.
+ * @brief Per-step output of a run, written either inline or through a pipeline.
+ */
+typedef struct {
+    traj_writer *writer;
+    int pipelined;     // Whether frames go through pl
+    pipeline pl;
+    double inline_ns;  // Time the simulation spent writing inline
+    int error;         // Set once an inline write failed
+} output_stage;
+
+/**
+ * @brief Pipeline consumer that appends a snapshot to the trajectory.
+ * 
+ * @param frame The snapshot.
+ * @param arg The trajectory writer.
+ * @return 0 on success, -1 on error.
+ */
+int write_snapshot(const pipeline_frame *frame, void *arg) {
+    return traj_write_frame(arg, frame->step, frame->x, frame->y, frame->theta);
+}
+
+/**
+ * @brief Open the trajectory output requested in the parameters.
  * 
- * @param step The current time step.
+ * @param p The simulation parameters.
+ * @return The output, or NULL when no output was requested. Exits if the file cannot be created.
+ */
+output_stage *open_output(const sim_params *p) {
+    if (p->output[0] == '\0') return NULL;
+    output_stage *out = calloc(1, sizeof(output_stage));
+    if (out == NULL) exit(1);
+    out->writer = traj_open_writer(p->output, p->n, p->l, p->precision, p->theta_precision, TRAJ_KEYFRAME_INTERVAL);
+    if (out->writer == NULL) exit(1);
+
+    if (p->pipeline > 0) {
+        if (pipeline_start(&out->pl, p->n, p->pipeline, write_snapshot, out->writer) != 0) {
+            fprintf(stderr, "Failed to start the output pipeline\n");
+            exit(1);
+        }
+        out->pipelined = 1;
+    }
+    return out;
+}
+
+/**
+ * @brief Output the state after one step.
+ * 
+ * @param out The output.
+ * @param step The time step.
  * @param x The array of x positions.
  * @param y The array of y positions.
- * @param vx The array of x velocities.
- * @param vy The array of y velocities.
- * @param n The number of birds.
+ * @param theta The array of directions.
+ */
+void output_frame(output_stage *out, long step, const double *x, const double *y, const double *theta) {
+    if (out->pipelined) {
+        pipeline_push(&out->pl, step, x, y, theta);
+        return;
+    }
+    double t_start = get_time_ns();
+    if (traj_write_frame(out->writer, step, x, y, theta) != 0) out->error = -1;
+    out->inline_ns += get_time_ns() - t_start;
+}
+
+/**
+ * @brief Finish all pending output, close it and print how long the simulation was held up by it.
+ * 
+ * Inline, the simulation is held up for the whole time spent writing; pipelined,
+ * while copying its state into the ring, waiting for a free slot and for the
+ * final drain. Exits with
+ * status 1 if any frame could not be written.
+ * 
+ * @param out The output (may be NULL).
  */
-void print_flock_positions(int step, double *x, double *y, double *vx, double *vy, int n) {
-    for (int i = 0; i < n; i++) {
-        printf("%d %d %f %f %f %f\n", step, i, x[i], y[i], vx[i], vy[i]);
+void close_output(output_stage *out) {
+    if (out == NULL) return;
+    double stall_ns = out->inline_ns;
+    if (out->pipelined) {
+        double t_drain = get_time_ns();
+        pipeline_finish(&out->pl);
+        double drain_ns = get_time_ns() - t_drain;
+        stall_ns = out->pl.copy_ns + out->pl.stall_ns + drain_ns;
+        printf("Output pipeline: copying %ld frames took %f %s, %ld of them waited %f %s for a free slot, final drain %f %s\n",
+               out->pl.frames, time_to_unit(out->pl.copy_ns, "ns", TIME_UNIT), TIME_UNIT,
+               out->pl.stalls, time_to_unit(out->pl.stall_ns, "ns", TIME_UNIT), TIME_UNIT,
+               time_to_unit(drain_ns, "ns", TIME_UNIT), TIME_UNIT);
+        if (out->pl.error) out->error = -1;
+    }
+    if (traj_close_writer(out->writer) != 0) out->error = -1;
+    printf("Output stall: %f %s\n", time_to_unit(stall_ns, "ns", TIME_UNIT), TIME_UNIT);
+
+    int error = out->error;
+    free(out);
+    if (error) {
+        fprintf(stderr, "Failed to write the trajectory\n");
+        exit(1);
     }
 }
 
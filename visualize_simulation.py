@@ -1,49 +1,24 @@
 import matplotlib.pyplot as plt
-import re
+import sys
 import numpy as np
 from matplotlib.animation import FuncAnimation
 
 
 def read_file(file_path):
-    pattern = r"(\d+)\s+(\d+)\s+([-+]?\d*\.?\d+)\s+([-+]?\d*\.?\d+)\s+([-+]?\d*\.?\d+)\s+([-+]?\d*\.?\d+)"
-    step = 0
-    with open(file_path) as f:
-        lines = f.readlines()
-        positions = []
-        velocities = []
-        for line in lines:
-            match = re.match(pattern, line)
-            if match:
-                step = int(match.group(1))
-                bird = int(match.group(2))
-                x_position = float(match.group(3))
-                y_position = float(match.group(4))
-                x_velocity = float(match.group(5))
-                y_velocity = float(match.group(6))
-
-                # Extend positions array as necessary
-                while len(positions) <= step:
-                    positions.append([])
-        
-                # Extend positions for bird as necessary
-                while len(positions[step]) <= bird:
-                    positions[step].append([])
-
-
-                # Extend positions array as necessary
-                while len(velocities) <= step:
-                    velocities.append([])
-        
-                # Extend positions for bird as necessary
-                while len(velocities[step]) <= bird:
-                    velocities[step].append([])
-
-                # Add position to positions array
-                positions[step][bird] = [x_position, y_position]
-                velocities[step][bird] = [x_velocity, y_velocity]
-    steps = step + 1
-    return np.asarray(positions), np.asarray(velocities), steps
-    
+    from activematter import Trajectory
+
+    # Velocities are not stored, only their direction; draw them with unit speed
+    with Trajectory(file_path) as trajectory:
+        steps = len(trajectory)
+        positions = np.empty((steps, trajectory.n, 2))
+        velocities = np.empty((steps, trajectory.n, 2))
+        for frame in range(steps):
+            _, x, y, theta = trajectory.read(frame)
+            positions[frame, :, 0] = x
+            positions[frame, :, 1] = y
+            velocities[frame, :, 0] = np.cos(theta)
+            velocities[frame, :, 1] = np.sin(theta)
+    return positions, velocities, steps
 
 
 def animate(name: str, positions: np.ndarray, velocities: np.ndarray, n_steps: int) -> None:
@@ -81,7 +56,42 @@ def animate(name: str, positions: np.ndarray, velocities: np.ndarray, n_steps: i
     ani.save(f"{name}.mp4", fps=60, writer='ffmpeg')
 
 
-positions, velocities, steps = read_file("simulation.txt")
-print(positions)
-print(velocities)
-animate("simulation", positions, velocities, steps)
+def animate_live(name: str, n_birds: int, n_steps: int) -> None:
+    from activematter import Simulation
+
+    plt.clf()
+    plt.close()
+    fig = plt.figure(figsize=(4,4), dpi=600)
+    ax = plt.gca()
+    ax.clear()
+
+    sim = Simulation(n_birds)
+    quiver = ax.quiver(sim.x, sim.y, sim.vx, sim.vy)
+
+    def step_function(frame: int) -> None:
+        sim.step(1)
+        quiver.set_offsets(np.column_stack([sim.x, sim.y]))
+        quiver.set_UVC(sim.vx, sim.vy)
+
+    ani = FuncAnimation(
+        fig,
+        step_function,
+        frames=n_steps,
+        interval=1,
+        blit=False,
+        repeat=False,
+    )
+
+    ani.save(f"{name}.mp4", fps=60, writer='ffmpeg')
+
+
+if len(sys.argv) >= 2 and sys.argv[1] == "--live":
+    # Step the C library directly instead of parsing a finished run
+    n_birds = int(sys.argv[2]) if len(sys.argv) >= 3 else 5000
+    n_steps = int(sys.argv[3]) if len(sys.argv) >= 4 else 1000
+    animate_live("simulation", n_birds, n_steps)
+else:
+    positions, velocities, steps = read_file("simulation.amt")
+    print(positions)
+    print(velocities)
+    animate("simulation", positions, velocities, steps)